@@ -0,0 +1,150 @@
+#ifndef TASK2_BATCH_H
+#define TASK2_BATCH_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace solution {
+
+    // Processing of many files in one process
+    namespace batch {
+
+        struct job {
+            std::string input_file;
+            std::string output_file;
+        };
+
+        // Manifest has one "<input file> <output file>" pair per line. Empty lines and lines starting with '#' are skipped.
+        inline std::vector<job> parseManifest(std::istream &is) {
+            std::vector<job> jobs;
+            std::string line;
+
+            while (std::getline(is, line)) {
+                std::istringstream iss(line);
+                job j;
+
+                if (!(iss >> j.input_file) || j.input_file[0] == '#') {
+                    continue;
+                }
+
+                if (!(iss >> j.output_file)) {
+                    throw std::logic_error("No output file for " + j.input_file + " in manifest");
+                }
+
+                jobs.push_back(j);
+            }
+
+            return jobs;
+        }
+
+        inline std::vector<job> loadManifest(const std::string &file_name) {
+            std::ifstream file(file_name);
+
+            if (!file.is_open()) {
+                throw std::logic_error("Cannot open manifest file " + file_name);
+            }
+
+            return parseManifest(file);
+        }
+
+        // Limits total memory of jobs running at the same time. A job larger than the whole budget
+        // is still run, but only when nothing else holds the budget.
+        class memory_budget {
+        private:
+            std::size_t _limit;
+            std::size_t _used = 0;
+            std::mutex _mutex;
+            std::condition_variable _released;
+
+        public:
+            // Zero limit means no limit
+            explicit memory_budget(std::size_t limit = 0) : _limit(limit) {
+            }
+
+            std::size_t acquire(std::size_t bytes) {
+                if (!_limit) {
+                    return 0;
+                }
+
+                bytes = std::min(bytes, _limit);
+                std::unique_lock<std::mutex> lock(_mutex);
+                _released.wait(lock, [this, bytes] { return _used + bytes <= _limit; });
+                _used += bytes;
+                return bytes;
+            }
+
+            void release(std::size_t bytes) {
+                if (!bytes) {
+                    return;
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _used -= bytes;
+                }
+                _released.notify_all();
+            }
+
+            // Holds part of the budget while in scope
+            class reservation {
+            private:
+                memory_budget &_budget;
+                std::size_t _bytes;
+
+            public:
+                reservation(memory_budget &budget, std::size_t bytes) : _budget(budget), _bytes(budget.acquire(bytes)) {
+                }
+
+                reservation(const reservation &) = delete;
+
+                reservation &operator=(const reservation &) = delete;
+
+                ~reservation() {
+                    _budget.release(_bytes);
+                }
+            };
+        };
+
+        // Runs `process(job, state)` for every job on a fixed number of threads. Each thread owns
+        // one default-constructed State, reused for all jobs it takes, e.g. for I/O buffers.
+        // `process` must handle its own errors, exception escaping a worker thread terminates the program.
+        template<class State, class Function>
+        void run(const std::vector<job> &jobs, unsigned threads, Function process) {
+            std::atomic<std::size_t> next(0);
+
+            auto worker = [&jobs, &next, &process]() {
+                State state;
+
+                for (std::size_t i = next++; i < jobs.size(); i = next++) {
+                    process(jobs[i], state);
+                }
+            };
+
+            threads = std::max(1u, std::min(threads, static_cast<unsigned>(jobs.size())));
+            std::vector<std::thread> pool;
+
+            for (unsigned i = 1; i < threads; ++i) {
+                pool.emplace_back(worker);
+            }
+
+            // Calling thread is one of the workers
+            worker();
+
+            for (auto &thread: pool) {
+                thread.join();
+            }
+        }
+    }
+
+} // solution
+
+#endif //TASK2_BATCH_H
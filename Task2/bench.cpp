@@ -0,0 +1,294 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "matrix.h"
+#include "matrix_processor.h"
+#include "matrix_io.h"
+#include "csv_generator.h"
+
+using namespace std;
+using namespace solution;
+using namespace solution::matrix_io;
+using namespace solution::generator;
+
+// Benchmarks of CSV parsing, processing and writing at several matrix sizes.
+// Results can be saved with --json and later compared with --baseline to catch regressions.
+
+struct bench_options {
+    vector<int> sizes = {128, 512, 1024};
+    int repeat = 3;
+    double zero_density = 0.001;
+    char separator = ' ';
+    bool json = false;
+    string baseline_file;
+    double tolerance = 0.2;
+};
+
+struct bench_result {
+    string name;
+    string type;
+    int size = 0;
+    double seconds = 0;
+    uint64_t bytes = 0;
+    uint64_t cells = 0;
+
+    string key() const {
+        return name + "/" + type + "/" + to_string(size);
+    }
+
+    double cellsPerSecond() const {
+        return seconds > 0 ? cells / seconds : 0;
+    }
+
+    double bytesPerSecond() const {
+        return seconds > 0 ? bytes / seconds : 0;
+    }
+};
+
+// Best time of several runs, `prepare` is not timed
+static double measure(int repeat, const function<void()> &prepare, const function<void()> &run) {
+    double best = 0;
+
+    for (int i = 0; i < repeat; ++i) {
+        prepare();
+        auto start = chrono::steady_clock::now();
+        run();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        best = i == 0 ? seconds : min(best, seconds);
+    }
+
+    return best;
+}
+
+template<class T>
+vector<bench_result> run_benchmarks(const string &type, int size, const bench_options &options) {
+    generator_options generator;
+    generator.rows = generator.columns = size;
+    generator.zeroDensity = options.zero_density;
+    generator.separator = options.separator;
+
+    ostringstream generated;
+    generateCsv<T>(generated, generator);
+    const string csv = generated.str();
+    const uint64_t cells = static_cast<uint64_t>(size) * size;
+
+    vector<bench_result> results;
+    matrix<T> m;
+
+    double parse = measure(options.repeat, [] {}, [&] {
+        istringstream iss(csv);
+        parseFromCsvStream(iss, m, options.separator);
+    });
+    results.push_back({"parse", type, size, parse, csv.size(), cells});
+
+    matrix_processor p;
+    double process = measure(options.repeat, [&] {
+        m = generateMatrix<T>(generator);
+    }, [&] {
+        p.process(m);
+    });
+    results.push_back({"process", type, size, process, cells * sizeof(T), cells});
+
+    string output;
+    double write = measure(options.repeat, [] {}, [&] {
+        ostringstream oss;
+        writeToCsvStream(oss, m, options.separator);
+        output = oss.str();
+    });
+    results.push_back({"write", type, size, write, output.size(), cells});
+
+    return results;
+}
+
+static void print_result(const bench_result &result, bool json) {
+    if (json) {
+        cout << "{\"benchmark\":\"" << result.name << "\",\"type\":\"" << result.type << "\",\"size\":" << result.size
+             << ",\"seconds\":" << result.seconds << ",\"bytes\":" << result.bytes << ",\"cells\":" << result.cells
+             << ",\"cells_per_second\":" << result.cellsPerSecond()
+             << ",\"bytes_per_second\":" << result.bytesPerSecond() << "}" << endl;
+        return;
+    }
+
+    cout << left << setw(8) << result.name << setw(8) << result.type << right << setw(6) << result.size << "^2"
+         << fixed << setprecision(2)
+         << setw(12) << result.seconds * 1000 << " ms"
+         << setw(12) << result.bytesPerSecond() / (1 << 20) << " MiB/s"
+         << setw(12) << result.cellsPerSecond() / 1e6 << " Mcells/s" << endl;
+    cout.unsetf(ios::floatfield);
+}
+
+// Reads "cells_per_second" of each benchmark from output of a previous --json run
+static map<string, double> load_baseline(const string &file_name) {
+    ifstream file(file_name);
+
+    if (!file.is_open()) {
+        throw logic_error("Cannot open baseline file " + file_name);
+    }
+
+    auto field = [](const string &line, const string &name) {
+        auto position = line.find("\"" + name + "\":");
+        if (position == string::npos) {
+            return string();
+        }
+
+        position += name.size() + 3;
+        auto end = line.find_first_of(",}", position);
+        auto value = line.substr(position, end - position);
+        value.erase(remove(value.begin(), value.end(), '"'), value.end());
+        return value;
+    };
+
+    map<string, double> baseline;
+    string line;
+
+    while (getline(file, line)) {
+        if (line.empty()) {
+            continue;
+        }
+
+        auto key = field(line, "benchmark") + "/" + field(line, "type") + "/" + field(line, "size");
+        baseline[key] = stod(field(line, "cells_per_second"));
+    }
+
+    return baseline;
+}
+
+static vector<int> parse_sizes(const string &list) {
+    vector<int> sizes;
+    istringstream iss(list);
+    string item;
+
+    while (getline(iss, item, ',')) {
+        sizes.push_back(stoi(item));
+    }
+
+    return sizes;
+}
+
+static void show_usage() {
+    cout << "Usage: Task2_bench [--sizes 128,512,1024] [--repeat N] [--zeros D] [--comma] [--json]" << endl <<
+         "                   [--baseline <file> [--tolerance 0.2]]" << endl <<
+         "       Task2_bench --generate <output file> <rows> <columns> [--double|--int] [--zeros D] [--comma]" << endl <<
+         "                   [--seed S]" << endl <<
+         "--baseline fails if throughput of any benchmark drops by more than tolerance against" << endl <<
+         "saved --json output of an earlier run." << endl;
+}
+
+static int generate(const vector<string> &arguments) {
+    if (arguments.size() < 4) {
+        show_usage();
+        return 1;
+    }
+
+    generator_options options;
+    options.rows = stoi(arguments[2]);
+    options.columns = stoi(arguments[3]);
+    bool is_double = false;
+
+    for (size_t i = 4; i < arguments.size(); ++i) {
+        if (arguments[i] == "--double") {
+            is_double = true;
+        } else if (arguments[i] == "--int") {
+            is_double = false;
+        } else if (arguments[i] == "--comma") {
+            options.separator = ',';
+        } else if (arguments[i] == "--zeros" && i + 1 < arguments.size()) {
+            options.zeroDensity = stod(arguments[++i]);
+        } else if (arguments[i] == "--seed" && i + 1 < arguments.size()) {
+            options.seed = static_cast<uint32_t>(stoul(arguments[++i]));
+        }
+    }
+
+    ofstream file(arguments[1]);
+
+    if (!file.is_open()) {
+        throw logic_error("Cannot open output file " + arguments[1]);
+    }
+
+    if (is_double) {
+        generateCsv<double>(file, options);
+    } else {
+        generateCsv<int>(file, options);
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    vector<string> arguments(argv + 1, argv + argc);
+    bench_options options;
+
+    try {
+        if (!arguments.empty() && arguments[0] == "--generate") {
+            return generate(arguments);
+        }
+
+        for (size_t i = 0; i < arguments.size(); ++i) {
+            const bool has_value = i + 1 < arguments.size();
+
+            if (arguments[i] == "--sizes" && has_value) {
+                options.sizes = parse_sizes(arguments[++i]);
+            } else if (arguments[i] == "--repeat" && has_value) {
+                options.repeat = max(1, stoi(arguments[++i]));
+            } else if (arguments[i] == "--zeros" && has_value) {
+                options.zero_density = stod(arguments[++i]);
+            } else if (arguments[i] == "--comma") {
+                options.separator = ',';
+            } else if (arguments[i] == "--json") {
+                options.json = true;
+            } else if (arguments[i] == "--baseline" && has_value) {
+                options.baseline_file = arguments[++i];
+            } else if (arguments[i] == "--tolerance" && has_value) {
+                options.tolerance = stod(arguments[++i]);
+            } else {
+                show_usage();
+                return 1;
+            }
+        }
+
+        vector<bench_result> results;
+
+        for (int size: options.sizes) {
+            for (auto &result: run_benchmarks<int>("int", size, options)) {
+                print_result(result, options.json);
+                results.push_back(result);
+            }
+
+            for (auto &result: run_benchmarks<double>("double", size, options)) {
+                print_result(result, options.json);
+                results.push_back(result);
+            }
+        }
+
+        if (options.baseline_file.empty()) {
+            return 0;
+        }
+
+        auto baseline = load_baseline(options.baseline_file);
+        int regressions = 0;
+
+        for (const auto &result: results) {
+            auto it = baseline.find(result.key());
+
+            if (it != baseline.end() && result.cellsPerSecond() < it->second * (1 - options.tolerance)) {
+                cerr << "Regression in " << result.key() << ": " << result.cellsPerSecond() << " cells/s, baseline "
+                     << it->second << " cells/s" << endl;
+                ++regressions;
+            }
+        }
+
+        return regressions ? 2 : 0;
+    }
+    catch (exception &e) {
+        cerr << "Error occurred. " << e.what() << endl;
+        return 1;
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef TASK2_CSV_GENERATOR_H
+#define TASK2_CSV_GENERATOR_H
+
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include "matrix_io.h"
+
+namespace solution {
+
+    // Random matrices for benchmarks and tests
+    namespace generator {
+
+        struct generator_options {
+            int rows = 1000;
+            int columns = 1000;
+            // Share of zero cells, i.e. cells to be interpolated
+            double zeroDensity = 0.001;
+            char separator = matrix_io::DEFAULT_SEPARATOR;
+            std::uint32_t seed = 1;
+        };
+
+        // Produces rows of random non-zero values with zeros spread at the given density
+        template<class T>
+        class row_generator {
+        private:
+            std::mt19937 _random;
+            std::bernoulli_distribution _zero;
+            std::uniform_int_distribution<int> _integer;
+            std::uniform_real_distribution<double> _real;
+
+            T nextValue() {
+                if (_zero(_random)) {
+                    return T();
+                }
+
+                if constexpr (std::is_floating_point<T>::value) {
+                    // Magnitude at least 1, so that the value does not count as zero
+                    double value = _real(_random);
+                    return static_cast<T>(value < 0 ? value - 1 : value + 1);
+                } else {
+                    int value = _integer(_random);
+                    return static_cast<T>(value == 0 ? 1 : value);
+                }
+            }
+
+        public:
+            explicit row_generator(const generator_options &options)
+                    : _random(options.seed), _zero(options.zeroDensity), _integer(-1000, 1000), _real(-1000, 1000) {
+            }
+
+            void next(std::vector<T> &row, int columns) {
+                row.resize(columns);
+
+                for (auto &value: row) {
+                    value = nextValue();
+                }
+            }
+        };
+
+        // Writes a random CSV matrix row by row, so the size is not limited by memory
+        template<class T>
+        void generateCsv(std::ostream &os, const generator_options &options) {
+            row_generator<T> rows(options);
+            matrix_io::csv_writer<T> writer;
+            std::vector<T> row;
+
+            for (int i = 0; i < options.rows; ++i) {
+                rows.next(row, options.columns);
+                writer.writeRow(os, row.data(), options.columns, options.separator);
+            }
+
+            writer.flush(os);
+        }
+
+        template<class T>
+        matrix<T> generateMatrix(const generator_options &options) {
+            row_generator<T> rows(options);
+            std::vector<std::vector<T>> cells(options.rows);
+
+            for (auto &row: cells) {
+                rows.next(row, options.columns);
+            }
+
+            return matrix<T>(std::move(cells));
+        }
+    }
+
+} // solution
+
+#endif //TASK2_CSV_GENERATOR_H
@@ -0,0 +1,123 @@
+#ifndef TASK2_KDTREE_H
+#define TASK2_KDTREE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "matrix.h"
+
+namespace solution {
+
+    // Static 2D kd-tree for nearest neighbour search among matrix cells. Nodes are stored
+    // implicitly in one vector: the median of a range is its node, halves are its subtrees.
+    class kd_tree_2d {
+    public:
+        struct neighbour {
+            matrix_cell cell;
+            double distance;
+        };
+
+    private:
+        std::vector<matrix_cell> _points;
+
+        static int coordinate(const matrix_cell &cell, int axis) {
+            return axis == 0 ? cell.row : cell.column;
+        }
+
+        static std::int64_t squaredDistance(const matrix_cell &a, const matrix_cell &b) {
+            const std::int64_t dRow = a.row - b.row;
+            const std::int64_t dColumn = a.column - b.column;
+            return dRow * dRow + dColumn * dColumn;
+        }
+
+        static bool closer(const neighbour &a, const neighbour &b) {
+            return a.distance < b.distance;
+        }
+
+        void build(std::size_t begin, std::size_t end, int axis) {
+            if (end - begin <= 1) {
+                return;
+            }
+
+            const std::size_t middle = begin + (end - begin) / 2;
+            std::nth_element(_points.begin() + begin, _points.begin() + middle, _points.begin() + end,
+                             [axis](const matrix_cell &a, const matrix_cell &b) {
+                                 return coordinate(a, axis) < coordinate(b, axis);
+                             });
+
+            build(begin, middle, 1 - axis);
+            build(middle + 1, end, 1 - axis);
+        }
+
+        // `found` is a max-heap by squared distance holding at most k neighbours
+        void search(const matrix_cell &query, std::size_t k, std::size_t begin, std::size_t end, int axis,
+                    std::vector<neighbour> &found) const {
+            if (begin >= end) {
+                return;
+            }
+
+            const std::size_t middle = begin + (end - begin) / 2;
+            const matrix_cell &node = _points[middle];
+            const auto distance = static_cast<double>(squaredDistance(query, node));
+
+            if (found.size() < k) {
+                found.push_back({node, distance});
+                std::push_heap(found.begin(), found.end(), closer);
+            } else if (distance < found.front().distance) {
+                std::pop_heap(found.begin(), found.end(), closer);
+                found.back() = {node, distance};
+                std::push_heap(found.begin(), found.end(), closer);
+            }
+
+            const auto split = static_cast<double>(coordinate(query, axis) - coordinate(node, axis));
+            const bool leftFirst = split < 0;
+
+            if (leftFirst) {
+                search(query, k, begin, middle, 1 - axis, found);
+            } else {
+                search(query, k, middle + 1, end, 1 - axis, found);
+            }
+
+            // The other half can only be closer than the splitting line
+            if (found.size() < k || split * split < found.front().distance) {
+                if (leftFirst) {
+                    search(query, k, middle + 1, end, 1 - axis, found);
+                } else {
+                    search(query, k, begin, middle, 1 - axis, found);
+                }
+            }
+        }
+
+    public:
+        explicit kd_tree_2d(std::vector<matrix_cell> points) : _points(std::move(points)) {
+            build(0, _points.size(), 0);
+        }
+
+        std::size_t size() const {
+            return _points.size();
+        }
+
+        // Finds up to k cells closest to `query`, nearest first, with their Euclidean distances.
+        // `found` is cleared; reusing it between calls avoids allocations.
+        void knnSearch(const matrix_cell &query, int k, std::vector<neighbour> &found) const {
+            found.clear();
+
+            if (k <= 0) {
+                return;
+            }
+
+            search(query, static_cast<std::size_t>(k), 0, _points.size(), 0, found);
+            std::sort_heap(found.begin(), found.end(), closer);
+
+            for (auto &n: found) {
+                n.distance = std::sqrt(n.distance);
+            }
+        }
+    };
+
+} // solution
+
+#endif //TASK2_KDTREE_H
@@ -2,18 +2,89 @@
 #include <cassert>
 #include <sstream>
 #include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <mutex>
+#include <thread>
 
 #include "matrix.h"
 #include "matrix_processor.h"
 #include "matrix_io.h"
+#include "matrix_binary.h"
+#include "matrix_pipeline.h"
+#include "matrix_fill.h"
+#include "matrix_incremental.h"
+#include "batch.h"
+#include "processing_stats.h"
 
 using namespace std;
 using namespace solution;
 using namespace solution::matrix_io;
 
+// Counts allocations of each thread for --stats
+void *operator new(size_t size) {
+    ++stats::threadAllocations();
+
+    if (void *p = malloc(size ? size : 1)) {
+        return p;
+    }
+
+    throw bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
 const char SEPARATOR_SPACE = ' ';
 const char SEPARATOR_COMMA = ',';
 
+// Straightforward cell by cell version of matrix_processor::process(), used as a reference in tests
+template<class T>
+vector<vector<T>> reference_process(vector<vector<T>> cells) {
+    auto get = [&cells](int row, int column) -> T {
+        if (row < 0 || row >= static_cast<int>(cells.size()) ||
+            column < 0 || column >= static_cast<int>(cells[row].size())) {
+            return 0;
+        }
+        return cells[row][column];
+    };
+
+    for (int row = 0; row < static_cast<int>(cells.size()); ++row) {
+        for (int column = 0; column < static_cast<int>(cells[row].size()); ++column) {
+            if (static_cast<int>(cells[row][column]) == 0) {
+                T sum = get(row - 1, column) + get(row + 1, column) + get(row, column - 1) + get(row, column + 1);
+                cells[row][column] = static_cast<T>(sum / 4.0);
+            }
+        }
+    }
+
+    return cells;
+}
+
+// Grid with isolated and adjacent zeros, negative values and fractions
+template<class T>
+vector<vector<T>> sample_cells(int rows, int columns) {
+    vector<vector<T>> cells(rows, vector<T>(columns));
+
+    for (int row = 0; row < rows; ++row) {
+        for (int column = 0; column < columns; ++column) {
+            int key = (row * 7 + column * 13) % 11;
+            cells[row][column] = key < 3 ? static_cast<T>(key * 0.25) : static_cast<T>((key - 6) * 3.5);
+        }
+    }
+
+    return cells;
+}
+
 void run_tests() {
     // Initialization
     {
@@ -88,6 +159,37 @@ void run_tests() {
         assert(oss.str() == "3.1415,2\n");
     }
 
+    // Output matches operator<< formatting
+    {
+        matrix<double> m({{1.0 / 3, -2.5, 1e-7, 123456789.0, 0}});
+        ostringstream expected;
+        expected << 1.0 / 3 << ',' << -2.5 << ',' << 1e-7 << ',' << 123456789.0 << ',' << 0.0 << endl;
+
+        ostringstream oss;
+        writeToCsvStream(oss, m, SEPARATOR_COMMA);
+        assert(oss.str() == expected.str());
+
+        ostringstream precise;
+        precise.precision(12);
+        writeToCsvStream(precise, m, SEPARATOR_COMMA);
+        assert(precise.str().substr(0, 15) == "0.333333333333,");
+
+        // Rows spanning several blocks
+        matrix<int> mi(sample_cells<int>(40, 50));
+        csv_writer<int> writer(64);
+        ostringstream blocks;
+        writer.write(blocks, mi, SEPARATOR_SPACE);
+
+        ostringstream reference;
+        for (int row = 0; row < mi.getRows(); ++row) {
+            for (int column = 0; column < mi.getColumns(); ++column) {
+                reference << mi[row][column] << (column + 1 < mi.getColumns() ? " " : "");
+            }
+            reference << endl;
+        }
+        assert(blocks.str() == reference.str());
+    }
+
     // Processing
     matrix_processor p;
     {
@@ -99,6 +201,217 @@ void run_tests() {
         assert(m[0][0] == 0.5);
     }
 
+    // Processing -- vectorized interior matches cell by cell scan
+    {
+        matrix<int> mi(sample_cells<int>(9, 23));
+        p.process(mi);
+        assert(mi == matrix<int>(reference_process(sample_cells<int>(9, 23))));
+
+        matrix<double> md(sample_cells<double>(9, 23));
+        p.process(md);
+        assert(md == matrix<double>(reference_process(sample_cells<double>(9, 23))));
+    }
+
+    // Processing -- only zero cells recorded on load
+    {
+        auto iss = istringstream("1 0 0\n0.5 2 0");
+        matrix<double> m;
+        vector<matrix_cell> zeros;
+        parseFromCsvStream(iss, m, SEPARATOR_SPACE, &zeros);
+        assert(zeros.size() == 4);
+        assert(zeros[0].row == 0 && zeros[0].column == 1);
+        assert(zeros[2].row == 1 && zeros[2].column == 0);
+
+        matrix<double> sparse(sample_cells<double>(9, 23));
+        auto found = p.findZeros(sparse);
+        p.process(sparse, found);
+        assert(sparse == matrix<double>(reference_process(sample_cells<double>(9, 23))));
+
+        matrix<int> sparse_int(sample_cells<int>(9, 23));
+        p.process(sparse_int, p.findZeros(sparse_int));
+        assert(sparse_int == matrix<int>(reference_process(sample_cells<int>(9, 23))));
+    }
+
+    // Processing -- stencil and predicate policies
+    {
+        basic_matrix_processor<stencils::average8> p8;
+        matrix<int> m({{8, 8, 8},
+                       {8, 0, 8},
+                       {8, 8, 0}});
+        p8.process(m);
+        assert(m[1][1] == (8 * 7 + 0) / 8);
+        // Out-of-boundary cells count as zero
+        assert(m[2][2] == (7 + 8 + 8) / 8);
+
+        basic_matrix_processor<stencils::threshold, stencils::always> clip(stencils::threshold{5, 1});
+        matrix<double> md({{2, 7.5}});
+        clip.process(md);
+        assert(md == matrix<double>({{1, 7.5}}));
+
+        // Custom predicate, weighted stencil
+        auto negative = [](double x) { return x < 0; };
+        basic_matrix_processor<stencils::weighted3x3, decltype(negative)> w(stencils::weighted3x3(), negative);
+        matrix<double> mw({{4, 4, 4},
+                           {4, -1, 4},
+                           {4, 4, 4}});
+        w.process(mw);
+        assert(mw[1][1] == 4);
+    }
+
+    // Processing -- fused passes give the same result as separate passes
+    {
+        basic_matrix_processor<stencils::average8> p8;
+        basic_matrix_processor<stencils::weighted3x3, stencils::below> pw(stencils::weighted3x3(), stencils::below{-5});
+        basic_matrix_processor<stencils::threshold, stencils::always> clip(stencils::threshold{-2, -2});
+
+        matrix<double> separate(sample_cells<double>(17, 13));
+        p.process(separate);
+        p8.process(separate);
+        pw.process(separate);
+        clip.process(separate);
+
+        matrix<double> fused(sample_cells<double>(17, 13));
+        fused_processor<matrix_processor, decltype(p8), decltype(pw), decltype(clip)>(p, p8, pw, clip).process(fused);
+        assert(fused == separate);
+    }
+
+    // Processing -- other element types, sums do not overflow
+    {
+        matrix<float> mf(sample_cells<float>(9, 23));
+        p.process(mf);
+        assert(mf == matrix<float>(reference_process(sample_cells<float>(9, 23))));
+
+        matrix<int16_t> m16({{30000, 30000, 30000},
+                             {30000, 0, 30000}});
+        p.process(m16);
+        assert(m16[1][1] == (30000 * 3 + 0) / 4);
+
+        matrix<uint16_t> mu16({{65535, 0, 65535}});
+        p.process(mu16);
+        assert(mu16[0][1] == 65535 / 2);
+
+        const int64_t big = int64_t(1) << 62;
+        matrix<int64_t> m64({{big, big + 3, big},
+                             {big + 1, 0, big + 2},
+                             {big, big, big}});
+        p.process(m64);
+        assert(m64[1][1] == big + 1);
+
+        matrix<int64_t> negative({{-7, 0, -2}});
+        p.process(negative);
+        assert(negative[0][1] == -2);
+
+        auto iss = istringstream("1 0 65535\n2 3 4");
+        matrix<uint16_t> parsed;
+        parseFromCsvStream(iss, parsed, SEPARATOR_SPACE);
+        p.process(parsed);
+        ostringstream oss;
+        writeToCsvStream(oss, parsed, SEPARATOR_SPACE);
+        assert(oss.str() == "1 16384 65535\n2 3 4\n");
+    }
+
+    // Processing -- pyramid fill of large holes
+    {
+        vector<vector<int>> cells(40, vector<int>(50, 10));
+        for (int row = 5; row < 35; ++row) {
+            fill(cells[row].begin() + 5, cells[row].begin() + 45, 0);
+        }
+
+        matrix<int> m(move(cells));
+        pyramid_filler filler;
+        filler.process(m);
+        assert(m == matrix<int>(vector<vector<int>>(40, vector<int>(50, 10))));
+        assert(filler.interpolatedCells() == 30 * 40);
+
+        // Ramp 1..64 along columns with a hole across most of it
+        vector<vector<double>> ramp(32, vector<double>(64));
+        for (int row = 0; row < 32; ++row) {
+            for (int column = 0; column < 64; ++column) {
+                bool hole = row >= 4 && row < 28 && column >= 4 && column < 60;
+                ramp[row][column] = hole ? 0 : column + 1;
+            }
+        }
+
+        auto holes = ramp;
+        matrix<double> md(move(holes));
+        filler.process(md);
+        for (int row = 0; row < 32; ++row) {
+            for (int column = 0; column < 64; ++column) {
+                if (ramp[row][column] != 0) {
+                    assert(md[row][column] == ramp[row][column]);
+                } else {
+                    assert(md[row][column] >= 1 && md[row][column] <= 64);
+                }
+            }
+        }
+
+        // Values follow the ramp instead of being dragged to zero
+        assert(md[16][8] < md[16][32] && md[16][32] < md[16][56]);
+
+        // Nothing to fill from
+        matrix<double> empty({{0, 0},
+                              {0, 0}});
+        filler.process(empty);
+        assert(empty == matrix<double>({{0, 0},
+                                        {0, 0}}));
+    }
+
+    // Processing -- k nearest cells found by kd-tree and inverse distance weighting
+    {
+        vector<matrix_cell> points;
+        for (int i = 0; i < 500; ++i) {
+            points.push_back({(i * 37) % 101, (i * 53) % 89});
+        }
+
+        kd_tree_2d tree(points);
+        vector<kd_tree_2d::neighbour> found;
+        for (matrix_cell query: {matrix_cell{0, 0}, matrix_cell{50, 44}, matrix_cell{120, -7}}) {
+            tree.knnSearch(query, 5, found);
+            assert(found.size() == 5);
+
+            // Squared distances are exact integers, distance is their correctly rounded square root
+            auto squared = [&query](const matrix_cell &cell) {
+                const int64_t row = cell.row - query.row, column = cell.column - query.column;
+                return row * row + column * column;
+            };
+
+            vector<int64_t> expected;
+            for (const auto &point: points) {
+                expected.push_back(squared(point));
+            }
+            sort(expected.begin(), expected.end());
+
+            for (size_t i = 0; i < found.size(); ++i) {
+                assert(squared(found[i].cell) == expected[i]);
+                assert(found[i].distance == sqrt(static_cast<double>(expected[i])));
+            }
+        }
+
+        idw_filler two(2, 2, 1);
+        matrix<double> m({{4, 0, 0, 0, 8}});
+        two.process(m);
+        assert(abs(m[0][1] - 4.4) < 1e-12);
+        assert(m[0][2] == 6);
+        assert(m[0][4] == 8);
+        assert(two.interpolatedCells() == 3);
+
+        // Parallel batches give the same result
+        vector<vector<int>> sparse(120, vector<int>(150));
+        for (int row = 0; row < 120; ++row) {
+            for (int column = 0; column < 150; ++column) {
+                if ((row * 31 + column * 17) % 50 == 0) {
+                    sparse[row][column] = row - column + 1000;
+                }
+            }
+        }
+
+        auto single_cells = sparse;
+        matrix<int> single(move(single_cells)), parallel(move(sparse));
+        idw_filler(8, 2, 1).process(single);
+        idw_filler(8, 2, 3).process(parallel);
+        assert(single == parallel);
+    }
+
     // File I/O -- ints + spaces
     {
         auto m = load<int>("input1.csv", SEPARATOR_SPACE);
@@ -127,6 +440,308 @@ void run_tests() {
         assert(f.good());
     }
 
+    // Binary format
+    {
+        matrix<double> m(sample_cells<double>(5, 7));
+        stringstream ss;
+        writeBinaryStream(ss, m);
+        assert(ss.str().size() == 64 + 5 * 7 * sizeof(double));
+
+        matrix<double> restored;
+        readBinaryStream(ss, restored);
+        assert(restored == m);
+
+        // Element type is checked
+        ss.seekg(0);
+        matrix<int> wrong;
+        bool thrown = false;
+        try {
+            readBinaryStream(ss, wrong);
+        }
+        catch (logic_error &) {
+            thrown = true;
+        }
+        assert(thrown);
+
+        auto output_file = "output3.bin";
+        matrix<int> mi(sample_cells<int>(4, 3));
+        saveBinary(output_file, mi);
+        assert(isBinaryFile(output_file));
+        assert(!isBinaryFile("input1.csv"));
+        assert(loadBinary<int>(output_file) == mi);
+
+        auto mapped = mapBinary<int>(output_file);
+        assert(mapped.getRows() == 4 && mapped.getColumns() == 3);
+        for (int row = 0; row < mi.getRows(); ++row) {
+            assert(equal(mi[row].begin(), mi[row].end(), mapped[row]));
+        }
+
+        // Corrupt headers are rejected instead of reading out of bounds or allocating the claimed size
+        auto rejected = [](binary_header header, const string &payload) {
+            string corrupt(reinterpret_cast<const char *>(&header), sizeof(header));
+            corrupt += payload;
+
+            bool read_thrown = false, map_thrown = false;
+            try {
+                istringstream iss(corrupt);
+                matrix<int> m;
+                readBinaryStream(iss, m);
+            }
+            catch (logic_error &) {
+                read_thrown = true;
+            }
+
+            auto corrupt_file = "output4.bin";
+            ofstream(corrupt_file, ios::binary) << corrupt;
+            try {
+                mapBinary<int>(corrupt_file);
+            }
+            catch (logic_error &) {
+                map_thrown = true;
+            }
+
+            return read_thrown && map_thrown;
+        };
+
+        const string payload(2 * 2 * sizeof(int), '\1');
+        auto header = makeBinaryHeader<int>(2, 2);
+        assert(!rejected(header, payload));
+        header.payloadOffset = 1 << 30;
+        assert(rejected(header, payload));
+        header = makeBinaryHeader<int>(INT_MAX, 2);
+        assert(rejected(header, payload));
+        header = makeBinaryHeader<int>(INT_MAX, INT_MAX);
+        assert(rejected(header, payload));
+        header.columns = 0;
+        assert(rejected(header, payload));
+        header = makeBinaryHeader<int>(0, 0);
+        header.columns = 5;
+        assert(rejected(header, payload));
+        assert(!rejected(makeBinaryHeader<int>(0, 0), ""));
+
+        matrix<int16_t> m16(sample_cells<int16_t>(3, 5));
+        stringstream ss16;
+        writeBinaryStream(ss16, m16);
+        assert(ss16.str().size() == 64 + 3 * 5 * sizeof(int16_t));
+        matrix<int16_t> restored16;
+        readBinaryStream(ss16, restored16);
+        assert(restored16 == m16);
+    }
+
+    // Pipelined processing gives the same output as processing in memory
+    {
+        matrix<double> m(sample_cells<double>(23, 9));
+        ostringstream csv;
+        writeToCsvStream(csv, m, SEPARATOR_COMMA);
+
+        p.process(m);
+        ostringstream expected;
+        writeToCsvStream(expected, m, SEPARATOR_COMMA);
+
+        for (size_t block_rows: {1, 2, 5, 256}) {
+            istringstream iss(csv.str());
+            ostringstream oss;
+            matrix_pipeline<double>(block_rows, 2).run(iss, oss, SEPARATOR_COMMA, p);
+            assert(oss.str() == expected.str());
+        }
+
+        istringstream single("0 4 0");
+        ostringstream single_output;
+        matrix_pipeline<int>().run(single, single_output, SEPARATOR_SPACE, p);
+        assert(single_output.str() == "1 4 1\n");
+
+        istringstream inconsistent("1 2\n3\n");
+        ostringstream ignored;
+        bool thrown = false;
+        try {
+            matrix_pipeline<int>(1, 1).run(inconsistent, ignored, SEPARATOR_SPACE, p);
+        }
+        catch (logic_error &) {
+            thrown = true;
+        }
+        assert(thrown);
+        // Rows before the error are not written as if the matrix ended there
+        assert(ignored.str().empty());
+
+        // Processing error stops the other stages and is rethrown
+        struct failing_processor {
+            void processRow(const int *, int *, const int *, int) {
+                throw logic_error("Processing failed");
+            }
+
+            uint64_t interpolatedCells() const {
+                return 0;
+            }
+        } failing;
+
+        // More rows than the queues hold, so the reader waits for room when processing fails
+        string rows;
+        for (int i = 0; i < 100; ++i) {
+            rows += "1 2\n";
+        }
+        istringstream many(rows);
+        thrown = false;
+        try {
+            matrix_pipeline<int>(1, 1).run(many, ignored, SEPARATOR_SPACE, failing);
+        }
+        catch (logic_error &) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+
+    // Statistics
+    {
+        istringstream iss("1 0 3\n4 5 6\n");
+        ostringstream oss;
+        stats::processing_stats statistics;
+        statistics.addLabel("input", "in \"1\".csv");
+        matrix_processor counting;
+        matrix_pipeline<int>().run(iss, oss, SEPARATOR_SPACE, counting, &statistics);
+        assert(statistics.rows == 2 && statistics.columns == 3);
+        assert(statistics.cellsInterpolated == 1 && counting.interpolatedCells() == 1);
+        assert(statistics.phases().size() == 3);
+
+        for (const auto &phase: statistics.phases()) {
+            if (phase.name == "read") {
+                assert(phase.bytes == 12 && phase.rows == 2);
+            } else if (phase.name == "write") {
+                assert(phase.bytes == oss.str().size());
+            }
+        }
+
+        ostringstream json;
+        statistics.writeJson(json);
+        assert(json.str().find("{\"input\":\"in \\\"1\\\".csv\",\"rows\":2,\"columns\":3,\"cells_interpolated\":1,") == 0);
+
+        // Total includes work of the reader and writer threads
+        const stats::phase_timer total_timer;
+        istringstream again("1 0 3\n4 5 6\n");
+        stats::processing_stats streamed;
+        matrix_pipeline<int>().run(again, oss, SEPARATOR_SPACE, counting, &streamed);
+        streamed.addTotal(total_timer, 12);
+
+        uint64_t allocations = 0;
+        for (const auto &phase: streamed.phases()) {
+            if (phase.name != "total") {
+                allocations += phase.allocations;
+            }
+        }
+
+        const auto &total = streamed.phases().back();
+        assert(total.name == "total" && total.bytes == 12 && total.rows == 2);
+        assert(total.allocations >= allocations);
+
+        // Allocations of the calling thread are counted
+        auto before = stats::threadAllocations();
+        auto allocated = make_unique<int>(1);
+        assert(stats::threadAllocations() == before + 1);
+    }
+
+    // Batch manifest and memory budget
+    {
+        istringstream manifest("# comment\n\ninput1.csv output1.csv\n  input2.csv   output2.csv  \n");
+        auto jobs = batch::parseManifest(manifest);
+        assert(jobs.size() == 2);
+        assert(jobs[1].input_file == "input2.csv" && jobs[1].output_file == "output2.csv");
+
+        batch::memory_budget budget(100);
+        assert(budget.acquire(60) == 60);
+        // Larger than the budget is clamped, so it can run alone
+        budget.release(60);
+        assert(budget.acquire(1000) == 100);
+        budget.release(100);
+
+        // Every job runs once, state is per thread
+        vector<batch::job> many(50, batch::job{"in", "out"});
+        atomic<int> processed(0);
+        batch::run<int>(many, 4, [&processed](const batch::job &, int &state) {
+            ++state;
+            ++processed;
+        });
+        assert(processed == 50);
+    }
+
+    // Incremental processing recomputes only affected rows and gives the same output
+    {
+        auto input_file = "incremental_input.csv", output_file = "incremental_output.csv";
+
+        auto write_input = [input_file](const vector<vector<double>> &cells) {
+            ofstream f(input_file);
+            writeToCsvStream(f, matrix<double>(vector<vector<double>>(cells)), SEPARATOR_COMMA);
+        };
+
+        auto expected_output = [&]() {
+            auto m = load<double>(input_file, SEPARATOR_COMMA);
+            p.process(m);
+            ostringstream oss;
+            writeToCsvStream(oss, m, SEPARATOR_COMMA);
+            return oss.str();
+        };
+
+        auto incremental_run = [&]() {
+            incremental_processor<double> incremental;
+            incremental.run(input_file, output_file, SEPARATOR_COMMA, p);
+            ifstream f(output_file, ios::binary);
+            assert(string(istreambuf_iterator<char>(f), istreambuf_iterator<char>()) == expected_output());
+            return incremental.recomputedRows();
+        };
+
+        filesystem::remove(incremental_processor<double>::indexFile(output_file));
+        auto cells = sample_cells<double>(40, 9);
+        write_input(cells);
+        assert(incremental_run() == 40);
+        assert(incremental_run() == 0);
+
+        // Changes propagate down while processed rows differ
+        cells[20][3] = 0;
+        cells[31][0] = 17.5;
+        write_input(cells);
+        auto recomputed = incremental_run();
+        assert(recomputed >= 4 && recomputed < 40);
+
+        cells.resize(45, vector<double>(9, 2.5));
+        cells[44][8] = 0;
+        write_input(cells);
+        assert(incremental_run() == 6);
+
+        cells.resize(30);
+        write_input(cells);
+        assert(incremental_run() == 1);
+
+        // Other number of columns processes everything again
+        for (auto &row: cells) {
+            row.push_back(0);
+        }
+        write_input(cells);
+        assert(incremental_run() == 30);
+
+        // Corrupted index is ignored
+        {
+            fstream index(incremental_processor<double>::indexFile(output_file), ios::binary | ios::in | ios::out);
+            const uint64_t rows = UINT64_MAX / 16;
+            index.seekp(8);
+            index.write(reinterpret_cast<const char *>(&rows), sizeof(rows));
+        }
+        assert(incremental_run() == 30);
+
+        // Failed run leaves no temporary files
+        {
+            ofstream f(input_file);
+            f << "1,2\n3\n";
+        }
+        bool failed = false;
+        try {
+            incremental_processor<double>().run(input_file, output_file, SEPARATOR_COMMA, p);
+        }
+        catch (logic_error &) {
+            failed = true;
+        }
+        assert(failed);
+        assert(!filesystem::exists(string(output_file) + ".tmp"));
+        assert(!filesystem::exists(incremental_processor<double>::valuesFile(output_file) + ".tmp"));
+    }
+
     cout << "Tests passed" << endl;
 }
 
@@ -138,20 +753,343 @@ static void show_usage(string name) {
         name = name.substr(static_cast<size_t>(name.rend() - itLastSlash));
     }
 
-    cout << "Usage: " << name << " <input file> <output file> --double|--int --space|--comma" << endl <<
-         "Example: " << name << " input1.csv output.csv --int --space" << endl;
+    cout << "Usage: " << name << " <input file> <output file> <type> [--space|--comma] [--binary] [--sparse] [--stats]" << endl <<
+         "       " << string(name.size(), ' ') << " [--incremental] [--fill average|pyramid|idw [--neighbours K]] [--threads N]" << endl <<
+         "       " << name << " --batch <manifest file> <type> [options] [--threads N] [--memory-limit MB]" << endl <<
+         "Example: " << name << " input1.csv output.csv --int --space" << endl <<
+         "Types: --double, --float, --int, --int16, --uint16, --int64." << endl <<
+         "Binary input files are detected automatically, --binary writes binary output." << endl <<
+         "--sparse visits only cells which were zero on load, faster when zeros are rare." << endl <<
+         "--fill pyramid fills large zero regions smoothly from their borders instead of averaging" << endl <<
+         "four adjacent cells. --fill idw fills zero cells by inverse distance weighting of K nearest" << endl <<
+         "non-zero cells (8 by default) on N threads, suited to grids with few non-zero cells." << endl <<
+         "--incremental keeps row hashes and processed values next to the output and on later runs" << endl <<
+         "recomputes only rows affected by changed input rows." << endl <<
+         "--stats prints per-phase timing, throughput and memory statistics as JSON line." << endl <<
+         "Manifest file lists one \"<input file> <output file>\" pair per line. Batch uses N threads in" << endl <<
+         "total, a streamed CSV to CSV file takes 3 of them, at least one file is processed at a time." << endl;
 }
 
+enum class fill_mode {
+    // Averages four adjacent cells, see matrix_processor
+    average,
+    // Fills holes of any size, see pyramid_filler
+    pyramid,
+    // Inverse distance weighting of nearest valid cells, see idw_filler
+    idw
+};
+
+struct processing_options {
+    char separator = SEPARATOR_SPACE;
+    fill_mode fill = fill_mode::average;
+    int neighbours = idw_filler::DEFAULT_NEIGHBOURS;
+    bool binary_output = false;
+    bool sparse = false;
+    bool stats = false;
+    bool incremental = false;
+
+    // Batch mode, output file is the manifest then
+    bool batch = false;
+    unsigned threads = max(1u, thread::hardware_concurrency());
+    size_t memory_limit = 0;
+};
+
+// Buffers reused between files processed by the same thread
 template<class T>
-void run_processing(const string &input_file, const string &output_file, const char separator) {
-    auto m = load<T>(input_file, separator);
+struct processing_buffers {
+    csv_reader<T> reader;
+    csv_writer<T> writer;
+    vector<matrix_cell> zeros;
+};
 
+uint64_t input_bytes(const string &input_file) {
+    error_code error;
+    auto size = filesystem::file_size(input_file, error);
+    return error ? 0 : static_cast<uint64_t>(size);
+}
+
+// CSV to CSV with the average fill is streamed row by row, other modes need the whole matrix in memory
+bool is_streamed(const processing_options &options, bool binary_input) {
+    return !binary_input && !options.binary_output && !options.sparse && options.fill == fill_mode::average;
+}
+
+template<class T>
+void run_processing(const string &input_file, const string &output_file, const processing_options &options,
+                    processing_buffers<T> &buffers, stats::processing_stats *statistics = nullptr) {
+    const stats::phase_timer total_timer;
     matrix_processor p;
-    p.process(m);
+    auto &zeros = buffers.zeros;
+    matrix<T> m;
+    const bool binary_input = isBinaryFile(input_file);
+
+    // Only rows changed since the previous run are processed
+    if (options.incremental) {
+        if (binary_input || options.binary_output || options.sparse || options.fill != fill_mode::average) {
+            throw logic_error("Incremental processing supports only CSV input and output with average fill");
+        }
+
+        incremental_processor<T>().run(input_file, output_file, options.separator, p, buffers.reader, buffers.writer,
+                                       statistics);
+
+        if (statistics) {
+            statistics->addTotal(total_timer, input_bytes(input_file));
+        }
+        return;
+    }
+
+    // CSV to CSV is streamed, so reading, processing and writing overlap
+    if (is_streamed(options, binary_input)) {
+        ifstream input(input_file);
+        if (!input.is_open()) {
+            throw logic_error("Cannot open input file " + input_file);
+        }
+
+        // Output is written to a temporary file, so malformed input does not destroy the existing output
+        const string temp_file = output_file + ".tmp";
+
+        try {
+            ofstream output(temp_file);
+            if (!output.is_open()) {
+                throw logic_error("Cannot open output file " + output_file);
+            }
+
+            matrix_pipeline<T>().run(input, output, options.separator, p, buffers.reader, buffers.writer, statistics);
+            output.close();
+
+            if (!output) {
+                throw logic_error("Cannot write output file " + output_file);
+            }
+
+            filesystem::rename(temp_file, output_file);
+        }
+        catch (...) {
+            error_code error;
+            filesystem::remove(temp_file, error);
+            throw;
+        }
+
+        if (statistics) {
+            statistics->addTotal(total_timer, input_bytes(input_file));
+        }
+        return;
+    }
+
+    auto record = [statistics](const stats::phase_timer &timer, const string &name, uint64_t bytes, uint64_t rows) {
+        if (statistics) {
+            statistics->addPhase(timer.stop(name, bytes, rows));
+        }
+    };
+    const uint64_t bytes_read = buffers.reader.bytes();
+    const uint64_t bytes_written = buffers.writer.bytes();
+    stats::phase_timer timer;
+
+    if (binary_input) {
+        m = loadBinary<T>(input_file);
+        if (options.sparse) {
+            zeros = p.findZeros(m);
+        }
+    } else {
+        m = load<T>(input_file, options.separator, options.sparse ? &zeros : nullptr, &buffers.reader);
+    }
+
+    const uint64_t payload = static_cast<uint64_t>(m.getRows()) * m.getColumns() * sizeof(T);
+    record(timer, "read", binary_input ? BINARY_PAYLOAD_OFFSET + payload : buffers.reader.bytes() - bytes_read,
+           m.getRows());
+    timer = stats::phase_timer();
+
+    uint64_t interpolated = 0;
+
+    if (options.fill == fill_mode::pyramid) {
+        pyramid_filler filler;
+        filler.process(m);
+        interpolated = filler.interpolatedCells();
+    } else if (options.fill == fill_mode::idw) {
+        // Files of a batch are already processed in parallel
+        idw_filler filler(options.neighbours, idw_filler::DEFAULT_POWER, options.batch ? 1 : options.threads);
+        filler.process(m);
+        interpolated = filler.interpolatedCells();
+    } else if (options.sparse) {
+        p.process(m, zeros);
+        interpolated = p.interpolatedCells();
+    } else {
+        p.process(m);
+        interpolated = p.interpolatedCells();
+    }
+
+    record(timer, "process", payload, m.getRows());
+    timer = stats::phase_timer();
+
+    if (options.binary_output) {
+        saveBinary(output_file, m);
+    } else {
+        save(output_file, m, options.separator, &buffers.writer);
+    }
+
+    record(timer, "write", options.binary_output ? BINARY_PAYLOAD_OFFSET + payload : buffers.writer.bytes() - bytes_written,
+           m.getRows());
 
-    save(output_file, m, separator);
+    if (statistics) {
+        statistics->rows = m.getRows();
+        statistics->columns = m.getColumns();
+        statistics->cellsInterpolated = interpolated;
+        statistics->addTotal(total_timer, input_bytes(input_file));
+    }
 }
 
+// Runs processing of a single file, printing statistics as JSON line if requested
+template<class T>
+void run_processing(const string &input_file, const string &output_file, const processing_options &options,
+                    processing_buffers<T> &buffers, mutex &output_mutex) {
+    if (!options.stats) {
+        run_processing(input_file, output_file, options, buffers);
+        return;
+    }
+
+    stats::processing_stats statistics;
+    statistics.addLabel("input", input_file);
+    statistics.addLabel("output", output_file);
+    run_processing(input_file, output_file, options, buffers, &statistics);
+
+    lock_guard<mutex> lock(output_mutex);
+    statistics.writeJson(cout) << endl;
+}
+
+template<class T>
+void run_processing(const string &input_file, const string &output_file, const processing_options &options) {
+    processing_buffers<T> buffers;
+    mutex output_mutex;
+    run_processing(input_file, output_file, options, buffers, output_mutex);
+}
+
+// Rough upper bound of memory needed to process the file along the path run_processing() takes
+template<class T>
+size_t estimate_memory(const string &input_file, const processing_options &options) {
+    error_code error;
+    auto size = static_cast<size_t>(filesystem::file_size(input_file, error));
+
+    if (error) {
+        return 0;
+    }
+
+    const bool binary_input = isBinaryFile(input_file);
+
+    // Streamed jobs hold only blocks of rows in the queues and stages, and the writer buffer
+    if (is_streamed(options, binary_input)) {
+        ifstream input(input_file);
+        string line;
+        while (getline(input, line) && line.empty()) {
+        }
+
+        const size_t columns = count(line.begin(), line.end(), options.separator) + 1;
+        const size_t blocks = 2 * matrix_pipeline<T>::DEFAULT_QUEUE_BLOCKS + 4;
+        return blocks * matrix_pipeline<T>::DEFAULT_BLOCK_ROWS * columns * sizeof(T) +
+               csv_writer<T>::DEFAULT_BLOCK_SIZE;
+    }
+
+    // Whole matrix: CSV value takes at least two characters
+    const size_t cells = binary_input ? size / sizeof(T) : size / 2;
+    size_t working = 0;
+
+    if (options.fill == fill_mode::pyramid) {
+        // Value and flag per cell on every level, levels add up to 4/3 of the matrix
+        working = cells * (sizeof(double) + 1) * 4 / 3;
+    } else if (options.fill == fill_mode::idw) {
+        // Positions of all cells, split into valid ones and holes, and values of holes
+        working = cells * (sizeof(matrix_cell) + sizeof(T));
+    } else if (options.sparse) {
+        working = cells * sizeof(matrix_cell);
+    }
+
+    return cells * sizeof(T) + working;
+}
+
+template<class T>
+void run_batch(const string &manifest_file, const processing_options &options) {
+    auto jobs = batch::loadManifest(manifest_file);
+    batch::memory_budget budget(options.memory_limit);
+    mutex output_mutex;
+    atomic<size_t> failed(0);
+
+    // Each streamed job runs a pipeline, whose threads count against --threads
+    const bool streamed = !options.incremental && is_streamed(options, false);
+    const unsigned threads = streamed ? max(1u, options.threads / matrix_pipeline<T>::THREADS) : options.threads;
+
+    batch::run<processing_buffers<T>>(jobs, threads,
+                                      [&](const batch::job &job, processing_buffers<T> &buffers) {
+        try {
+            batch::memory_budget::reservation memory(budget, estimate_memory<T>(job.input_file, options));
+            run_processing(job.input_file, job.output_file, options, buffers, output_mutex);
+        }
+        catch (exception &e) {
+            lock_guard<mutex> lock(output_mutex);
+            cout << "Error occurred in " << job.input_file << ". " << e.what() << endl;
+            ++failed;
+        }
+    });
+
+    cout << "Processed " << jobs.size() - failed << " of " << jobs.size() << " files" << endl;
+}
+
+// Value following the option at `i`, which is advanced to it
+const string &option_value(const vector<string> &arguments, size_t &i) {
+    if (i + 1 >= arguments.size()) {
+        throw logic_error("Missing value of " + arguments[i]);
+    }
+
+    return arguments[++i];
+}
+
+unsigned long long option_number(const vector<string> &arguments, size_t &i, unsigned long long min,
+                                 unsigned long long max) {
+    const string &option = arguments[i];
+    const string &text = option_value(arguments, i);
+    unsigned long long value = 0;
+    auto result = from_chars(text.data(), text.data() + text.size(), value);
+
+    if (result.ec != errc() || result.ptr != text.data() + text.size() || value < min || value > max) {
+        throw logic_error("Invalid value of " + option + ": " + text + ", expected a number from " +
+                          to_string(min) + " to " + to_string(max));
+    }
+
+    return value;
+}
+
+fill_mode parse_fill_mode(const string &name) {
+    if (name == "average") {
+        return fill_mode::average;
+    } else if (name == "pyramid") {
+        return fill_mode::pyramid;
+    } else if (name == "idw") {
+        return fill_mode::idw;
+    }
+
+    throw logic_error("Unknown fill mode " + name);
+}
+
+template<class T>
+void run(const string &input_file, const string &output_file, const processing_options &options) {
+    if (options.batch) {
+        run_batch<T>(output_file, options);
+    } else {
+        run_processing<T>(input_file, output_file, options);
+    }
+}
+
+// Element type flags, each instantiates the whole processing for its type
+struct data_type_entry {
+    const char *flag;
+    void (*run)(const string &, const string &, const processing_options &);
+};
+
+constexpr data_type_entry DATA_TYPES[] = {
+        {"--double", &run<double>},
+        {"--float",  &run<float>},
+        {"--int",    &run<int>},
+        {"--int16",  &run<int16_t>},
+        {"--uint16", &run<uint16_t>},
+        {"--int64",  &run<int64_t>},
+};
+
 int main(int argc, char *argv[]) {
     if (argc < 3) {
         // Simple way to run unit tests
@@ -180,19 +1118,46 @@ int main(int argc, char *argv[]) {
     auto input_file = arguments[0];
     auto output_file = arguments[1];
     auto data_type = arguments[2];
-    char separator = SEPARATOR_SPACE;
-
-    if (arguments.size() > 3 && arguments[3] == "--comma") {
-        separator = SEPARATOR_COMMA;
-    }
+    processing_options options;
+    options.batch = input_file == "--batch";
 
     try {
-        if (data_type == "--double") {
-            run_processing<double>(input_file, output_file, separator);
-        } else if (data_type == "--int") {
-            run_processing<int>(input_file, output_file, separator);
+        for (size_t i = 3; i < arguments.size(); ++i) {
+            const string &option = arguments[i];
+
+            if (option == "--comma") {
+                options.separator = SEPARATOR_COMMA;
+            } else if (option == "--space") {
+                options.separator = SEPARATOR_SPACE;
+            } else if (option == "--binary") {
+                options.binary_output = true;
+            } else if (option == "--sparse") {
+                options.sparse = true;
+            } else if (option == "--stats") {
+                options.stats = true;
+            } else if (option == "--incremental") {
+                options.incremental = true;
+            } else if (option == "--fill") {
+                options.fill = parse_fill_mode(option_value(arguments, i));
+            } else if (option == "--neighbours") {
+                options.neighbours = static_cast<int>(option_number(arguments, i, 1, INT_MAX));
+            } else if (option == "--threads") {
+                options.threads = static_cast<unsigned>(option_number(arguments, i, 1, INT_MAX));
+            } else if (option == "--memory-limit") {
+                options.memory_limit = static_cast<size_t>(option_number(arguments, i, 0, SIZE_MAX >> 20)) << 20;
+            } else {
+                throw logic_error("Unknown option " + option);
+            }
+        }
+
+        auto type = find_if(begin(DATA_TYPES), end(DATA_TYPES), [&data_type](const data_type_entry &entry) {
+            return data_type == entry.flag;
+        });
+
+        if (type != end(DATA_TYPES)) {
+            type->run(input_file, output_file, options);
         } else {
-            cout << "Unknown data type!" << endl;
+            cout << "Unknown data type " << data_type << endl;
         }
     }
     catch (exception &e) {
@@ -6,9 +6,17 @@
 #define TASK2_MATRIX_H
 
 #include <vector>
+#include <stdexcept>
+#include <initializer_list>
 
 namespace solution {
 
+    // Position of a single cell
+    struct matrix_cell {
+        int row;
+        int column;
+    };
+
     template<class T>
     class matrix {
     private:
@@ -24,6 +32,8 @@ namespace solution {
 
         matrix(matrix &&m) = default;
 
+        matrix &operator=(matrix &&m) = default;
+
         matrix(const matrix &) = delete;
 
         // Allows uniform initialization
@@ -33,6 +43,10 @@ namespace solution {
             _columns = _rows > 0 ? _elements[0].size() : 0;
         }
 
+        // Disambiguates brace initialization like matrix<int>({{1}})
+        matrix(std::initializer_list<row_type> rows) : matrix(std::vector<row_type>(rows)) {
+        }
+
         int getRows() const {
             return _rows;
         }
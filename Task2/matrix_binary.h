@@ -0,0 +1,419 @@
+#ifndef TASK2_MATRIX_BINARY_H
+#define TASK2_MATRIX_BINARY_H
+
+#include <cstdint>
+#include <cstring>
+#include <climits>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "matrix.h"
+
+namespace solution {
+
+    // Binary matrix container: fixed 64 byte header followed by raw row-major payload.
+    namespace matrix_io {
+        const char BINARY_MAGIC[4] = {'M', 'T', 'X', 'B'};
+        const std::uint8_t BINARY_VERSION = 1;
+        const std::uint8_t BYTE_ORDER_LITTLE = 1;
+        const std::uint8_t BYTE_ORDER_BIG = 2;
+
+        // Payload starts at this offset, so it is aligned for any element type
+        const std::uint64_t BINARY_PAYLOAD_OFFSET = 64;
+
+        enum class element_type : std::uint8_t {
+            int32 = 1,
+            float64 = 2,
+            float32 = 3,
+            int16 = 4,
+            uint16 = 5,
+            int64 = 6
+        };
+
+        template<class T>
+        struct element_type_of;
+
+        template<>
+        struct element_type_of<int> {
+            static_assert(sizeof(int) == 4, "int32 element type expects 32 bit int");
+            static constexpr element_type value = element_type::int32;
+        };
+
+        template<>
+        struct element_type_of<double> {
+            static constexpr element_type value = element_type::float64;
+        };
+
+        template<>
+        struct element_type_of<float> {
+            static_assert(sizeof(float) == 4, "float32 element type expects 32 bit float");
+            static constexpr element_type value = element_type::float32;
+        };
+
+        template<>
+        struct element_type_of<std::int16_t> {
+            static constexpr element_type value = element_type::int16;
+        };
+
+        template<>
+        struct element_type_of<std::uint16_t> {
+            static constexpr element_type value = element_type::uint16;
+        };
+
+        template<>
+        struct element_type_of<std::int64_t> {
+            static constexpr element_type value = element_type::int64;
+        };
+
+        struct binary_header {
+            char magic[4];
+            std::uint8_t version;
+            std::uint8_t elementType;
+            std::uint8_t byteOrder;
+            std::uint8_t elementSize;
+            std::uint64_t rows;
+            std::uint64_t columns;
+            std::uint64_t payloadOffset;
+            std::uint8_t reserved[32];
+        };
+
+        static_assert(sizeof(binary_header) == BINARY_PAYLOAD_OFFSET, "Binary header must be 64 bytes");
+
+        namespace detail {
+            inline std::uint8_t nativeByteOrder() {
+                const std::uint16_t probe = 1;
+                std::uint8_t first;
+                std::memcpy(&first, &probe, 1);
+                return first ? BYTE_ORDER_LITTLE : BYTE_ORDER_BIG;
+            }
+
+            inline void swapBytes(void *value, std::size_t size) {
+                auto bytes = static_cast<unsigned char *>(value);
+                std::reverse(bytes, bytes + size);
+            }
+
+            // Bytes left in a seekable stream, -1 if the stream cannot seek
+            inline std::streamoff remainingBytes(std::istream &is) {
+                if (is.eof()) {
+                    return 0;
+                }
+
+                const auto position = is.tellg();
+                if (position < 0) {
+                    return -1;
+                }
+
+                is.seekg(0, std::ios::end);
+                const auto end = is.tellg();
+                is.seekg(position);
+                return end < 0 ? -1 : static_cast<std::streamoff>(end - position);
+            }
+
+            // Checks the header against the expected element type, converting it to native byte order.
+            template<class T>
+            void validateHeader(binary_header &header) {
+                if (std::memcmp(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0) {
+                    throw std::logic_error("Not a binary matrix");
+                }
+
+                if (header.version != BINARY_VERSION) {
+                    throw std::logic_error("Unsupported binary matrix version");
+                }
+
+                if (header.byteOrder != BYTE_ORDER_LITTLE && header.byteOrder != BYTE_ORDER_BIG) {
+                    throw std::logic_error("Unknown binary matrix byte order");
+                }
+
+                if (header.byteOrder != nativeByteOrder()) {
+                    swapBytes(&header.rows, sizeof(header.rows));
+                    swapBytes(&header.columns, sizeof(header.columns));
+                    swapBytes(&header.payloadOffset, sizeof(header.payloadOffset));
+                }
+
+                if (header.elementType != static_cast<std::uint8_t>(element_type_of<T>::value) ||
+                    header.elementSize != sizeof(T)) {
+                    throw std::logic_error("Binary matrix element type mismatch");
+                }
+
+                if (header.rows > INT_MAX || header.columns > INT_MAX || (header.rows == 0) != (header.columns == 0) ||
+                    header.payloadOffset < sizeof(binary_header) || header.payloadOffset % alignof(T) != 0) {
+                    throw std::logic_error("Corrupted binary matrix header");
+                }
+            }
+        }
+
+        // Header of a native byte order matrix, payload follows it immediately. Matrix without cells
+        // is stored as 0 x 0.
+        template<class T>
+        binary_header makeBinaryHeader(int rows, int columns) {
+            if (rows == 0 || columns == 0) {
+                rows = columns = 0;
+            }
+
+            binary_header header = {};
+            std::memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+            header.version = BINARY_VERSION;
+            header.elementType = static_cast<std::uint8_t>(element_type_of<T>::value);
+            header.byteOrder = detail::nativeByteOrder();
+            header.elementSize = sizeof(T);
+            header.rows = static_cast<std::uint64_t>(rows);
+            header.columns = static_cast<std::uint64_t>(columns);
+            header.payloadOffset = BINARY_PAYLOAD_OFFSET;
+            return header;
+        }
+
+        template<class T>
+        std::ostream &writeBinaryStream(std::ostream &os, const matrix<T> &m) {
+            const binary_header header = makeBinaryHeader<T>(m.getRows(), m.getColumns());
+            os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+            const auto rowBytes = static_cast<std::streamsize>(m.getColumns() * sizeof(T));
+            for (int row = 0; row < m.getRows(); ++row) {
+                os.write(reinterpret_cast<const char *>(m[row].data()), rowBytes);
+            }
+
+            return os;
+        }
+
+        template<class T>
+        std::istream &readBinaryStream(std::istream &is, matrix<T> &m) {
+            binary_header header;
+            if (!is.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+                throw std::logic_error("Binary matrix header is truncated");
+            }
+
+            detail::validateHeader<T>(header);
+            is.ignore(static_cast<std::streamsize>(header.payloadOffset - sizeof(header)));
+
+            const bool swap = header.byteOrder != detail::nativeByteOrder();
+            const int rows = static_cast<int>(header.rows);
+            const int columns = static_cast<int>(header.columns);
+
+            // Header is not trusted: the payload must fit into the rest of the stream, if it can be measured,
+            // and rows are allocated only as they are read
+            if (rows != 0) {
+                const auto remaining = detail::remainingBytes(is);
+                if (!is || (remaining >= 0 && static_cast<std::uint64_t>(remaining) / sizeof(T) / columns < header.rows)) {
+                    throw std::logic_error("Binary matrix payload is truncated");
+                }
+            }
+
+            m.resize(0, columns);
+
+            for (int row = 0; row < rows; ++row) {
+                m.addRow();
+                T *data = m[row].data();
+                if (!is.read(reinterpret_cast<char *>(data), static_cast<std::streamsize>(columns * sizeof(T)))) {
+                    throw std::logic_error("Binary matrix payload is truncated");
+                }
+
+                if (swap) {
+                    for (int column = 0; column < columns; ++column) {
+                        detail::swapBytes(data + column, sizeof(T));
+                    }
+                }
+            }
+
+            return is;
+        }
+
+        // Checks file signature, so that binary and CSV inputs can be told apart
+        inline bool isBinaryFile(const std::string &file_name) {
+            std::ifstream file(file_name, std::ios::binary);
+            char magic[sizeof(BINARY_MAGIC)] = {};
+            file.read(magic, sizeof(magic));
+            return file && std::memcmp(magic, BINARY_MAGIC, sizeof(magic)) == 0;
+        }
+
+        template<class T>
+        matrix<T> loadBinary(const std::string &file_name) {
+            std::ifstream file(file_name, std::ios::binary);
+
+            if (!file.is_open()) {
+                throw std::logic_error("Cannot open input file " + file_name);
+            }
+
+            matrix<T> m;
+            readBinaryStream(file, m);
+            return m;
+        }
+
+        template<class T>
+        void saveBinary(const std::string &file_name, const matrix<T> &m) {
+            std::ofstream file(file_name, std::ios::binary);
+
+            if (!file.is_open()) {
+                throw std::logic_error("Cannot open output file " + file_name);
+            }
+
+            writeBinaryStream(file, m);
+        }
+
+        // Read-only view of a binary matrix file mapped into memory. Rows point directly into the mapping.
+        template<class T>
+        class mapped_matrix {
+        private:
+            void *_address = nullptr;
+            std::size_t _length = 0;
+            const T *_data = nullptr;
+            int _rows = 0;
+            int _columns = 0;
+
+            void unmap() {
+                if (_address) {
+#ifdef _WIN32
+                    UnmapViewOfFile(_address);
+#else
+                    munmap(_address, _length);
+#endif
+                }
+
+                _address = nullptr;
+                _length = 0;
+                _data = nullptr;
+                _rows = _columns = 0;
+            }
+
+            void map(const std::string &file_name) {
+#ifdef _WIN32
+                HANDLE file = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                          FILE_ATTRIBUTE_NORMAL, nullptr);
+                if (file == INVALID_HANDLE_VALUE) {
+                    throw std::logic_error("Cannot open input file " + file_name);
+                }
+
+                LARGE_INTEGER size;
+                GetFileSizeEx(file, &size);
+                _length = static_cast<std::size_t>(size.QuadPart);
+
+                HANDLE mapping = _length ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+                CloseHandle(file);
+
+                if (mapping) {
+                    // The view keeps the mapping alive after its handle is closed
+                    _address = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                    CloseHandle(mapping);
+                }
+#else
+                int file = open(file_name.c_str(), O_RDONLY);
+                if (file < 0) {
+                    throw std::logic_error("Cannot open input file " + file_name);
+                }
+
+                struct stat info;
+                fstat(file, &info);
+                _length = static_cast<std::size_t>(info.st_size);
+
+                if (_length) {
+                    void *address = mmap(nullptr, _length, PROT_READ, MAP_PRIVATE, file, 0);
+                    _address = address == MAP_FAILED ? nullptr : address;
+                }
+                close(file);
+#endif
+                if (!_address) {
+                    _length = 0;
+                    throw std::logic_error("Cannot map input file " + file_name);
+                }
+            }
+
+        public:
+            mapped_matrix() = default;
+
+            explicit mapped_matrix(const std::string &file_name) {
+                map(file_name);
+
+                try {
+                    if (_length < sizeof(binary_header)) {
+                        throw std::logic_error("Binary matrix header is truncated");
+                    }
+
+                    binary_header header;
+                    std::memcpy(&header, _address, sizeof(header));
+                    detail::validateHeader<T>(header);
+
+                    if (header.byteOrder != detail::nativeByteOrder()) {
+                        throw std::logic_error("Cannot map binary matrix with foreign byte order, use loadBinary()");
+                    }
+
+                    // Divisions instead of multiplication, so a corrupt header cannot overflow the check
+                    if (header.payloadOffset > _length ||
+                        (header.columns != 0 &&
+                         (_length - header.payloadOffset) / sizeof(T) / header.columns < header.rows)) {
+                        throw std::logic_error("Binary matrix payload is truncated");
+                    }
+
+                    _data = reinterpret_cast<const T *>(static_cast<const char *>(_address) + header.payloadOffset);
+                    _rows = static_cast<int>(header.rows);
+                    _columns = static_cast<int>(header.columns);
+                }
+                catch (...) {
+                    unmap();
+                    throw;
+                }
+            }
+
+            mapped_matrix(mapped_matrix &&other) noexcept {
+                *this = std::move(other);
+            }
+
+            mapped_matrix &operator=(mapped_matrix &&other) noexcept {
+                if (this != &other) {
+                    unmap();
+                    std::swap(_address, other._address);
+                    std::swap(_length, other._length);
+                    std::swap(_data, other._data);
+                    std::swap(_rows, other._rows);
+                    std::swap(_columns, other._columns);
+                }
+
+                return *this;
+            }
+
+            mapped_matrix(const mapped_matrix &) = delete;
+
+            mapped_matrix &operator=(const mapped_matrix &) = delete;
+
+            ~mapped_matrix() {
+                unmap();
+            }
+
+            int getRows() const {
+                return _rows;
+            }
+
+            int getColumns() const {
+                return _columns;
+            }
+
+            const T *operator[](int row) const {
+                if (row < 0 || row >= _rows) {
+                    throw std::out_of_range("Index out of range!");
+                }
+
+                return _data + static_cast<std::size_t>(row) * _columns;
+            }
+        };
+
+        template<class T>
+        mapped_matrix<T> mapBinary(const std::string &file_name) {
+            return mapped_matrix<T>(file_name);
+        }
+    }
+
+} // solution
+
+#endif //TASK2_MATRIX_BINARY_H
@@ -0,0 +1,287 @@
+#ifndef TASK2_MATRIX_FILL_H
+#define TASK2_MATRIX_FILL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "kdtree.h"
+#include "matrix.h"
+#include "matrix_stencils.h"
+
+namespace solution {
+
+    // Fills holes, i.e. cells selected by Predicate, with values of the surrounding valid cells using
+    // a push-pull image pyramid. Push halves the grid until it is a single cell, each coarse cell
+    // being the mean of its valid 2x2 children. Pull goes back and fills every cell without a value
+    // by bilinear upsampling of the coarser level. Holes of any size are filled smoothly from their
+    // border in O(rows * columns) work, valid cells are never changed.
+    template<class Predicate = stencils::is_zero>
+    class basic_pyramid_filler {
+    private:
+        Predicate _predicate;
+
+        // Statistics
+        std::uint64_t _interpolated = 0;
+
+        struct level {
+            int rows = 0;
+            int columns = 0;
+            std::vector<double> values;
+            // Cells with a value, either valid or filled from finer levels
+            std::vector<char> known;
+
+            level(int rows, int columns)
+                    : rows(rows), columns(columns),
+                      values(static_cast<std::size_t>(rows) * columns),
+                      known(static_cast<std::size_t>(rows) * columns) {
+            }
+
+            std::size_t index(int row, int column) const {
+                return static_cast<std::size_t>(row) * columns + column;
+            }
+        };
+
+        // Push: coarse cell is the mean of known cells among its 2x2 children
+        static level coarsen(const level &fine) {
+            level coarse((fine.rows + 1) / 2, (fine.columns + 1) / 2);
+
+            for (int row = 0; row < coarse.rows; ++row) {
+                for (int column = 0; column < coarse.columns; ++column) {
+                    double sum = 0;
+                    int count = 0;
+
+                    for (int r = 2 * row; r < std::min(2 * row + 2, fine.rows); ++r) {
+                        for (int c = 2 * column; c < std::min(2 * column + 2, fine.columns); ++c) {
+                            if (fine.known[fine.index(r, c)]) {
+                                sum += fine.values[fine.index(r, c)];
+                                ++count;
+                            }
+                        }
+                    }
+
+                    if (count) {
+                        coarse.values[coarse.index(row, column)] = sum / count;
+                        coarse.known[coarse.index(row, column)] = 1;
+                    }
+                }
+            }
+
+            return coarse;
+        }
+
+        // Position of fine cell centre on the coarse grid, clamped at borders
+        static void coarsePosition(int fine, int coarseSize, int &first, int &second, double &fraction) {
+            const double position = std::clamp((fine + 0.5) / 2 - 0.5, 0.0, coarseSize - 1.0);
+            first = static_cast<int>(std::floor(position));
+            second = std::min(first + 1, coarseSize - 1);
+            fraction = position - first;
+        }
+
+        // Pull: unknown fine cells get bilinear interpolation of the completely known coarse level
+        static void refine(level &fine, const level &coarse) {
+            for (int row = 0; row < fine.rows; ++row) {
+                int up, down;
+                double dy;
+                coarsePosition(row, coarse.rows, up, down, dy);
+
+                for (int column = 0; column < fine.columns; ++column) {
+                    if (fine.known[fine.index(row, column)]) {
+                        continue;
+                    }
+
+                    int left, right;
+                    double dx;
+                    coarsePosition(column, coarse.columns, left, right, dx);
+
+                    const double top = (1 - dx) * coarse.values[coarse.index(up, left)] +
+                                       dx * coarse.values[coarse.index(up, right)];
+                    const double bottom = (1 - dx) * coarse.values[coarse.index(down, left)] +
+                                          dx * coarse.values[coarse.index(down, right)];
+                    fine.values[fine.index(row, column)] = (1 - dy) * top + dy * bottom;
+                    fine.known[fine.index(row, column)] = 1;
+                }
+            }
+        }
+
+    public:
+        explicit basic_pyramid_filler(Predicate predicate = Predicate()) : _predicate(predicate) {
+        }
+
+        // Number of cells filled since construction or the last resetStatistics()
+        std::uint64_t interpolatedCells() const {
+            return _interpolated;
+        }
+
+        void resetStatistics() {
+            _interpolated = 0;
+        }
+
+        // Matrix without valid cells is left as is
+        template<class T>
+        void process(matrix<T> &m) {
+            if (m.getRows() == 0 || m.getColumns() == 0) {
+                return;
+            }
+
+            std::vector<level> levels;
+            levels.emplace_back(m.getRows(), m.getColumns());
+            auto &base = levels.front();
+            std::uint64_t holes = 0;
+
+            for (int row = 0; row < m.getRows(); ++row) {
+                for (int column = 0; column < m.getColumns(); ++column) {
+                    const T value = m[row][column];
+
+                    if (_predicate(value)) {
+                        ++holes;
+                    } else {
+                        base.values[base.index(row, column)] = static_cast<double>(value);
+                        base.known[base.index(row, column)] = 1;
+                    }
+                }
+            }
+
+            if (holes == 0) {
+                return;
+            }
+
+            while (levels.back().rows > 1 || levels.back().columns > 1) {
+                levels.push_back(coarsen(levels.back()));
+            }
+
+            if (!levels.back().known.front()) {
+                return;
+            }
+
+            for (auto i = levels.size() - 1; i > 0; --i) {
+                refine(levels[i - 1], levels[i]);
+            }
+
+            const auto &filled = levels.front();
+
+            for (int row = 0; row < m.getRows(); ++row) {
+                for (int column = 0; column < m.getColumns(); ++column) {
+                    if (_predicate(m[row][column])) {
+                        m[row][column] = static_cast<T>(filled.values[filled.index(row, column)]);
+                    }
+                }
+            }
+
+            _interpolated += holes;
+        }
+    };
+
+    using pyramid_filler = basic_pyramid_filler<>;
+
+    // Fills holes, i.e. cells selected by Predicate, by inverse distance weighting of the k nearest
+    // valid cells: sum(v / d^power) / sum(1 / d^power). Suited to grids where most cells are holes,
+    // so that adjacent cells carry no information. Valid cells are indexed by a kd-tree, holes are
+    // filled in batches on several threads. Only original valid cells take part, so the result
+    // does not depend on the order of filling.
+    template<class Predicate = stencils::is_zero>
+    class basic_idw_filler {
+    private:
+        Predicate _predicate;
+        int _neighbours;
+        double _power;
+        unsigned _threads;
+
+        // Statistics
+        std::uint64_t _interpolated = 0;
+
+        static constexpr std::size_t BATCH_SIZE = 4096;
+
+    public:
+        static constexpr int DEFAULT_NEIGHBOURS = 8;
+        static constexpr double DEFAULT_POWER = 2;
+
+        explicit basic_idw_filler(int neighbours = DEFAULT_NEIGHBOURS, double power = DEFAULT_POWER,
+                                  unsigned threads = std::thread::hardware_concurrency(),
+                                  Predicate predicate = Predicate())
+                : _predicate(predicate), _neighbours(std::max(neighbours, 1)), _power(power),
+                  _threads(std::max(threads, 1u)) {
+        }
+
+        // Number of cells filled since construction or the last resetStatistics()
+        std::uint64_t interpolatedCells() const {
+            return _interpolated;
+        }
+
+        void resetStatistics() {
+            _interpolated = 0;
+        }
+
+        // Matrix without valid cells is left as is
+        template<class T>
+        void process(matrix<T> &m) {
+            std::vector<matrix_cell> valid, holes;
+
+            for (int row = 0; row < m.getRows(); ++row) {
+                for (int column = 0; column < m.getColumns(); ++column) {
+                    (_predicate(m[row][column]) ? holes : valid).push_back({row, column});
+                }
+            }
+
+            if (valid.empty() || holes.empty()) {
+                return;
+            }
+
+            const kd_tree_2d tree(std::move(valid));
+            std::vector<T> values(holes.size());
+            std::atomic<std::size_t> next(0);
+
+            // Holes are only read here and written once all are computed
+            auto worker = [this, &m, &tree, &holes, &values, &next]() {
+                std::vector<kd_tree_2d::neighbour> found;
+
+                for (std::size_t begin = next.fetch_add(BATCH_SIZE); begin < holes.size();
+                     begin = next.fetch_add(BATCH_SIZE)) {
+                    const std::size_t end = std::min(begin + BATCH_SIZE, holes.size());
+
+                    for (std::size_t i = begin; i < end; ++i) {
+                        tree.knnSearch(holes[i], _neighbours, found);
+                        double sum = 0, weights = 0;
+
+                        for (const auto &n: found) {
+                            const double weight = 1 / std::pow(n.distance, _power);
+                            sum += weight * static_cast<double>(m[n.cell.row][n.cell.column]);
+                            weights += weight;
+                        }
+
+                        values[i] = static_cast<T>(sum / weights);
+                    }
+                }
+            };
+
+            const auto batches = (holes.size() + BATCH_SIZE - 1) / BATCH_SIZE;
+            const auto threads = static_cast<unsigned>(std::min<std::size_t>(_threads, batches));
+            std::vector<std::thread> pool;
+
+            for (unsigned i = 1; i < threads; ++i) {
+                pool.emplace_back(worker);
+            }
+
+            // Calling thread is one of the workers
+            worker();
+
+            for (auto &thread: pool) {
+                thread.join();
+            }
+
+            for (std::size_t i = 0; i < holes.size(); ++i) {
+                m[holes[i].row][holes[i].column] = values[i];
+            }
+
+            _interpolated += holes.size();
+        }
+    };
+
+    using idw_filler = basic_idw_filler<>;
+
+} // solution
+
+#endif //TASK2_MATRIX_FILL_H
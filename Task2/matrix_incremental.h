@@ -0,0 +1,423 @@
+#ifndef TASK2_MATRIX_INCREMENTAL_H
+#define TASK2_MATRIX_INCREMENTAL_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "matrix_io.h"
+#include "matrix_binary.h"
+#include "processing_stats.h"
+
+namespace solution {
+
+    // Reprocesses a CSV matrix whose earlier version was already processed, recomputing only the rows
+    // affected by changes. Output row i depends on processed row i - 1 and input rows i and i + 1, so
+    // a changed input row i invalidates output rows from i - 1 on, for as long as recomputed rows
+    // differ from their previous values. Other rows are copied from the previous output.
+    //
+    // Two sidecar files are kept next to the output: `<output>.index` with a hash of every input row
+    // and length of its output row, and `<output>.values` with the processed matrix in binary format,
+    // so that neighbours of recomputed rows have full precision. Without valid sidecars all rows are
+    // processed and the sidecars are created. Sidecars are only valid for the same Processor.
+    template<class T>
+    class incremental_processor {
+    private:
+        static constexpr char INDEX_MAGIC[4] = {'M', 'T', 'X', 'I'};
+        static constexpr std::uint8_t INDEX_VERSION = 1;
+
+        struct index_header {
+            char magic[4];
+            std::uint8_t version;
+            std::uint8_t elementType;
+            char separator;
+            std::uint8_t reserved;
+            std::uint64_t rows;
+            std::uint64_t columns;
+            // Size and modification time of the output file, to notice it was overwritten
+            std::uint64_t outputBytes;
+            std::int64_t outputTime;
+        };
+
+        struct row_entry {
+            std::uint64_t inputHash;
+            std::uint64_t outputBytes;
+        };
+
+        // State of the previous run
+        struct previous_state {
+            index_header header = {};
+            std::vector<row_entry> rows;
+            std::vector<std::uint64_t> offsets;
+            matrix_io::mapped_matrix<T> values;
+        };
+
+        // Thrown when the new input has a different number of columns, all rows are processed then
+        struct shape_changed {
+        };
+
+        // Thrown when the previous output cannot be read as the index describes, all rows are processed then
+        struct previous_invalid {
+        };
+
+        std::uint64_t _recomputed = 0;
+
+        // FNV-1a
+        static std::uint64_t hashLine(const std::string &line) {
+            std::uint64_t hash = 14695981039346656037ull;
+
+            for (unsigned char c: line) {
+                hash = (hash ^ c) * 1099511628211ull;
+            }
+
+            return hash;
+        }
+
+        static std::int64_t modificationTime(const std::string &file_name) {
+            return static_cast<std::int64_t>(std::filesystem::last_write_time(file_name).time_since_epoch().count());
+        }
+
+        static bool loadPrevious(const std::string &output_file, const char separator, previous_state &previous) {
+            std::ifstream index(indexFile(output_file), std::ios::binary);
+            auto &header = previous.header;
+
+            if (!index.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+                std::memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 ||
+                header.version != INDEX_VERSION ||
+                header.elementType != static_cast<std::uint8_t>(matrix_io::element_type_of<T>::value) ||
+                header.separator != separator) {
+                return false;
+            }
+
+            std::error_code error;
+            const auto outputBytes = std::filesystem::file_size(output_file, error);
+
+            if (error || outputBytes != header.outputBytes || modificationTime(output_file) != header.outputTime) {
+                return false;
+            }
+
+            // Row count is checked against the index size before anything is allocated for it
+            const auto indexBytes = std::filesystem::file_size(indexFile(output_file), error);
+
+            if (error || indexBytes < sizeof(index_header) ||
+                (indexBytes - sizeof(index_header)) % sizeof(row_entry) != 0 ||
+                (indexBytes - sizeof(index_header)) / sizeof(row_entry) != header.rows) {
+                return false;
+            }
+
+            previous.rows.resize(static_cast<std::size_t>(header.rows));
+            if (!index.read(reinterpret_cast<char *>(previous.rows.data()),
+                            static_cast<std::streamsize>(previous.rows.size() * sizeof(row_entry)))) {
+                return false;
+            }
+
+            std::uint64_t offset = 0;
+            previous.offsets.clear();
+
+            for (const auto &row: previous.rows) {
+                previous.offsets.push_back(offset);
+                offset += row.outputBytes;
+            }
+
+            if (offset != header.outputBytes) {
+                return false;
+            }
+
+            try {
+                previous.values = matrix_io::mapBinary<T>(valuesFile(output_file));
+            }
+            catch (std::exception &) {
+                return false;
+            }
+
+            return static_cast<std::uint64_t>(previous.values.getRows()) == header.rows &&
+                   static_cast<std::uint64_t>(previous.values.getColumns()) == header.columns;
+        }
+
+        // Copies [begin, end) bytes of the previous output
+        static void copyBytes(std::istream &is, std::ostream &os, std::uint64_t begin, std::uint64_t end,
+                              std::vector<char> &buffer) {
+            is.seekg(static_cast<std::streamoff>(begin));
+
+            while (begin < end) {
+                const auto size = static_cast<std::streamsize>(std::min<std::uint64_t>(buffer.size(), end - begin));
+
+                if (!is.read(buffer.data(), size)) {
+                    throw previous_invalid();
+                }
+
+                os.write(buffer.data(), size);
+                begin += static_cast<std::uint64_t>(size);
+            }
+        }
+
+        template<class Processor>
+        void update(const std::string &input_file, const std::string &output_file, const char separator,
+                    Processor &p, matrix_io::csv_reader<T> &reader, matrix_io::csv_writer<T> &writer,
+                    previous_state *previous, stats::processing_stats *statistics) {
+            std::ifstream input(input_file);
+            if (!input.is_open()) {
+                throw std::logic_error("Cannot open input file " + input_file);
+            }
+
+            std::ifstream previousOutput;
+            if (previous) {
+                previousOutput.open(output_file, std::ios::binary);
+            }
+
+            const std::string outputTemp = output_file + ".tmp";
+            const std::string valuesTemp = valuesFile(output_file) + ".tmp";
+            std::ofstream output(outputTemp, std::ios::binary);
+            std::ofstream values(valuesTemp, std::ios::binary);
+
+            if (!output.is_open() || !values.is_open()) {
+                throw std::logic_error("Cannot open output file " + output_file);
+            }
+
+            // Header is rewritten once the size is known
+            auto valuesHeader = matrix_io::makeBinaryHeader<T>(0, 0);
+            values.write(reinterpret_cast<const char *>(&valuesHeader), sizeof(valuesHeader));
+
+            const std::uint64_t previousRows = previous ? previous->header.rows : 0;
+            int columns = previous ? static_cast<int>(previous->header.columns) : -1;
+
+            auto changed = [previous, previousRows](std::uint64_t row, std::uint64_t hash) {
+                return row >= previousRows || previous->rows[row].inputHash != hash;
+            };
+
+            std::vector<row_entry> entries;
+            std::vector<char> buffer(matrix_io::csv_writer<T>::DEFAULT_BLOCK_SIZE);
+            std::uint64_t copyBegin = 0, copyEnd = 0;
+
+            auto flushCopy = [&]() {
+                if (copyBegin < copyEnd) {
+                    writer.flush(output);
+                    copyBytes(previousOutput, output, copyBegin, copyEnd, buffer);
+                }
+                copyBegin = copyEnd = 0;
+            };
+
+            // Input rows i and i + 1, parsed only when needed. `current` becomes output row i in place.
+            std::string line, nextLine;
+            std::vector<T> current, below, above;
+            bool hasLine = reader.readLine(input), hasNext = false;
+            bool currentParsed = false, belowParsed = false;
+            std::uint64_t hash = 0, nextHash = 0;
+
+            if (hasLine) {
+                line = reader.line();
+                hash = hashLine(line);
+            }
+
+            if (hasLine && (hasNext = reader.readLine(input))) {
+                nextLine = reader.line();
+                nextHash = hashLine(nextLine);
+            }
+
+            auto parse = [&](const std::string &text, std::vector<T> &row) {
+                reader.parseLine(text, separator);
+                reader.swapRow(row);
+
+                if (columns < 0) {
+                    columns = static_cast<int>(row.size());
+                } else if (static_cast<int>(row.size()) != columns) {
+                    if (previous) {
+                        throw shape_changed();
+                    }
+                    throw std::logic_error("Columns amount inconsistent");
+                }
+            };
+
+            auto rowBytes = [&columns]() {
+                return static_cast<std::streamsize>(columns * sizeof(T));
+            };
+
+            // Output row i - 1, and whether it differs from the previous output
+            const T *up = nullptr;
+            bool upChanged = false;
+
+            for (std::uint64_t row = 0; hasLine; ++row) {
+                const bool belowChanged = hasNext ? changed(row + 1, nextHash) : row + 1 < previousRows;
+
+                if (!previous || upChanged || changed(row, hash) || belowChanged) {
+                    if (!currentParsed) {
+                        parse(line, current);
+                    }
+
+                    if (hasNext && !belowParsed) {
+                        parse(nextLine, below);
+                        belowParsed = true;
+                    }
+
+                    p.processRow(up, current.data(), hasNext ? below.data() : nullptr, columns);
+
+                    flushCopy();
+                    const auto bytes = writer.bytes() + writer.buffered();
+                    writer.writeRow(output, current.data(), columns, separator);
+                    entries.push_back({hash, writer.bytes() + writer.buffered() - bytes});
+                    values.write(reinterpret_cast<const char *>(current.data()), rowBytes());
+
+                    upChanged = row >= previousRows ||
+                                std::memcmp(current.data(), previous->values[static_cast<int>(row)], rowBytes()) != 0;
+                    above.swap(current);
+                    up = above.data();
+                    ++_recomputed;
+                } else {
+                    const auto &entry = previous->rows[row];
+                    const auto offset = previous->offsets[row];
+
+                    if (copyBegin == copyEnd) {
+                        copyBegin = offset;
+                    }
+                    copyEnd = offset + entry.outputBytes;
+
+                    entries.push_back(entry);
+                    up = previous->values[static_cast<int>(row)];
+                    values.write(reinterpret_cast<const char *>(up), rowBytes());
+                    upChanged = false;
+                }
+
+                // Move to the next row
+                line.swap(nextLine);
+                hash = nextHash;
+                current.swap(below);
+                currentParsed = belowParsed;
+                belowParsed = false;
+                hasLine = hasNext;
+
+                if (hasLine && (hasNext = reader.readLine(input))) {
+                    nextLine = reader.line();
+                    nextHash = hashLine(nextLine);
+                } else {
+                    hasNext = false;
+                }
+            }
+
+            flushCopy();
+            writer.flush(output);
+            output.close();
+            previousOutput.close();
+
+            valuesHeader = matrix_io::makeBinaryHeader<T>(static_cast<int>(entries.size()), std::max(columns, 0));
+            values.seekp(0);
+            values.write(reinterpret_cast<const char *>(&valuesHeader), sizeof(valuesHeader));
+            values.close();
+
+            if (!output || !values) {
+                throw std::logic_error("Cannot write output file " + output_file);
+            }
+
+            // Previous values must be unmapped before they are replaced
+            if (previous) {
+                previous->values = matrix_io::mapped_matrix<T>();
+            }
+
+            std::filesystem::rename(outputTemp, output_file);
+            std::filesystem::rename(valuesTemp, valuesFile(output_file));
+
+            index_header header = {};
+            std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+            header.version = INDEX_VERSION;
+            header.elementType = static_cast<std::uint8_t>(matrix_io::element_type_of<T>::value);
+            header.separator = separator;
+            header.rows = entries.size();
+            header.columns = entries.empty() ? 0 : static_cast<std::uint64_t>(columns);
+            header.outputBytes = std::filesystem::file_size(output_file);
+            header.outputTime = modificationTime(output_file);
+
+            std::ofstream index(indexFile(output_file), std::ios::binary | std::ios::trunc);
+            index.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            index.write(reinterpret_cast<const char *>(entries.data()),
+                        static_cast<std::streamsize>(entries.size() * sizeof(row_entry)));
+
+            if (!index) {
+                throw std::logic_error("Cannot write index file " + indexFile(output_file));
+            }
+
+            if (statistics) {
+                statistics->rows = header.rows;
+                statistics->columns = header.columns;
+            }
+        }
+
+    public:
+        static std::string indexFile(const std::string &output_file) {
+            return output_file + ".index";
+        }
+
+        static std::string valuesFile(const std::string &output_file) {
+            return output_file + ".values";
+        }
+
+        // Rows processed since construction or the last resetStatistics(), the rest were copied
+        std::uint64_t recomputedRows() const {
+            return _recomputed;
+        }
+
+        void resetStatistics() {
+            _recomputed = 0;
+        }
+
+        // Same output as processing the whole input, written over `output_file`
+        template<class Processor>
+        void run(const std::string &input_file, const std::string &output_file, const char separator,
+                 Processor &p, matrix_io::csv_reader<T> &reader, matrix_io::csv_writer<T> &writer,
+                 stats::processing_stats *statistics = nullptr) {
+            const stats::phase_timer timer;
+            const auto recomputed = _recomputed;
+            const auto interpolated = p.interpolatedCells();
+            const auto bytes = reader.bytes();
+
+            previous_state previous;
+            const bool hasPrevious = loadPrevious(output_file, separator, previous);
+
+            auto rerun = [&]() {
+                writer.discard();
+                previous.values = matrix_io::mapped_matrix<T>();
+                _recomputed = recomputed;
+                update(input_file, output_file, separator, p, reader, writer, nullptr, statistics);
+            };
+
+            try {
+                try {
+                    update(input_file, output_file, separator, p, reader, writer, hasPrevious ? &previous : nullptr,
+                           statistics);
+                }
+                catch (shape_changed &) {
+                    rerun();
+                }
+                catch (previous_invalid &) {
+                    rerun();
+                }
+            }
+            catch (...) {
+                // Temporary files are left only by a failed update
+                std::error_code error;
+                std::filesystem::remove(output_file + ".tmp", error);
+                std::filesystem::remove(valuesFile(output_file) + ".tmp", error);
+                throw;
+            }
+
+            if (statistics) {
+                statistics->cellsInterpolated = p.interpolatedCells() - interpolated;
+                statistics->addPhase(timer.stop("incremental", reader.bytes() - bytes, _recomputed - recomputed));
+            }
+        }
+
+        template<class Processor>
+        void run(const std::string &input_file, const std::string &output_file, const char separator,
+                 Processor &p, stats::processing_stats *statistics = nullptr) {
+            matrix_io::csv_reader<T> reader;
+            matrix_io::csv_writer<T> writer;
+            run(input_file, output_file, separator, p, reader, writer, statistics);
+        }
+    };
+
+} // solution
+
+#endif //TASK2_MATRIX_INCREMENTAL_H
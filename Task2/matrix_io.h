@@ -7,86 +7,304 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <locale>
+#include <type_traits>
 #include <vector>
 
 #include "matrix.h"
+#include "matrix_kernels.h"
 
 namespace solution {
 
     namespace matrix_io {
         const char DEFAULT_SEPARATOR = ' ';
 
+        // Formats rows into a reusable buffer and writes it to the stream in big blocks.
+        // Output is the same as writing each value with operator<< and ending rows with std::endl.
         template<class T>
-        std::ostream &
-        writeToCsvStream(std::ostream &os, const matrix<T> &m, const char separator = DEFAULT_SEPARATOR) {
-            for (int row = 0; row < m.getRows(); row++) {
-                for (int column = 0; column < m.getColumns(); column++) {
-                    os << m[row][column];
+        class csv_writer {
+        private:
+            // Room reserved for one formatted value. to_chars output always fits, since precision is at most
+            // MAX_PRECISION; streams with higher precision or other non-default flags use operator<< instead.
+            static constexpr int MAX_VALUE_LENGTH = 128;
+            static constexpr int MAX_PRECISION = 64;
+
+            std::vector<char> _buffer;
+            std::size_t _size = 0;
+            std::size_t _blockSize;
+
+            // Statistics
+            std::uint64_t _bytes = 0;
+            std::uint64_t _rows = 0;
+
+            // to_chars gives the same text as operator<< only for default formatting flags
+            static bool isDefaultFormat(std::ostream &os) {
+                const auto flags = os.flags();
+                const auto custom = std::ios_base::floatfield | std::ios_base::showpos |
+                                    std::ios_base::showpoint | std::ios_base::uppercase;
+
+                return !(flags & custom) &&
+                       (flags & std::ios_base::basefield) == std::ios_base::dec &&
+                       os.width() == 0 &&
+                       os.precision() <= MAX_PRECISION &&
+                       os.getloc() == std::locale::classic();
+            }
+
+            void reserve(std::size_t length) {
+                if (_buffer.size() < _size + length) {
+                    _buffer.resize(std::max(_buffer.size() * 2, _size + length));
+                }
+            }
+
+            char *formatValue(char *first, char *last, T value, int precision) {
+                if constexpr (std::is_floating_point<T>::value) {
+                    return std::to_chars(first, last, value, std::chars_format::general, precision).ptr;
+                } else {
+                    return std::to_chars(first, last, value).ptr;
+                }
+            }
+
+        public:
+            static constexpr std::size_t DEFAULT_BLOCK_SIZE = 1 << 20;
+
+            explicit csv_writer(std::size_t blockSize = DEFAULT_BLOCK_SIZE) : _blockSize(blockSize) {
+                _buffer.resize(blockSize + MAX_VALUE_LENGTH);
+            }
+
+            void writeRow(std::ostream &os, const T *row, int columns, const char separator) {
+                ++_rows;
+
+                if (!isDefaultFormat(os)) {
+                    flush(os);
+                    const auto start = os.tellp();
+
+                    for (int column = 0; column < columns; column++) {
+                        os << row[column];
+
+                        if (column != columns - 1) {
+                            os << separator;
+                        }
+                    }
+                    os << '\n';
 
-                    if (column != m.getColumns() - 1) {
-                        os << separator;
+                    if (start != std::ostream::pos_type(-1)) {
+                        _bytes += static_cast<std::uint64_t>(os.tellp() - start);
                     }
+                    return;
                 }
 
-                os << std::endl;
+                const int precision = static_cast<int>(os.precision());
+
+                for (int column = 0; column < columns; column++) {
+                    reserve(MAX_VALUE_LENGTH + 1);
+                    char *end = formatValue(&_buffer[_size], &_buffer[0] + _buffer.size(), row[column], precision);
+                    _size = end - &_buffer[0];
+
+                    if (column != columns - 1) {
+                        _buffer[_size++] = separator;
+                    }
+                }
+
+                reserve(1);
+                _buffer[_size++] = '\n';
+
+                if (_size >= _blockSize) {
+                    flush(os);
+                }
+            }
+
+            void write(std::ostream &os, const matrix<T> &m, const char separator) {
+                for (int row = 0; row < m.getRows(); row++) {
+                    writeRow(os, m[row].data(), m.getColumns(), separator);
+                }
+
+                flush(os);
+                os.flush();
+            }
+
+            // Writes out buffered data, the buffer itself is kept for reuse
+            void flush(std::ostream &os) {
+                if (_size) {
+                    os.write(_buffer.data(), static_cast<std::streamsize>(_size));
+                    _bytes += _size;
+                    _size = 0;
+                }
+            }
+
+            // Bytes formatted but not flushed yet
+            std::size_t buffered() const {
+                return _size;
+            }
+
+            // Drops output not flushed yet
+            void discard() {
+                _size = 0;
+            }
+
+            // Bytes and rows written since construction or the last resetStatistics()
+            std::uint64_t bytes() const {
+                return _bytes;
+            }
+
+            std::uint64_t rows() const {
+                return _rows;
             }
 
+            void resetStatistics() {
+                _bytes = _rows = 0;
+            }
+        };
+
+        template<class T>
+        std::ostream &
+        writeToCsvStream(std::ostream &os, const matrix<T> &m, const char separator = DEFAULT_SEPARATOR) {
+            csv_writer<T> writer;
+            writer.write(os, m, separator);
             return os;
         }
 
+        // Parses CSV rows reusing line and value buffers, so one reader can load many files.
         template<class T>
-        std::istream &parseFromCsvStream(std::istream &is, matrix<T> &m, const char separator = DEFAULT_SEPARATOR) {
-            m.resize(0, 0);
-            int row = 0, column = 0;
+        class csv_reader {
+        private:
+            std::string _line;
+            std::string _item;
+            std::istringstream _itemStream;
+            std::vector<T> _row;
 
-            while (!is.eof()) {
-                std::string line;
-                std::getline(is, line);
+            // Statistics
+            std::uint64_t _bytes = 0;
+            std::uint64_t _rows = 0;
 
-                if (!line.length()) {
-                    continue;
+            T parseValue(const char *first, const char *last) {
+                T value = T();
+                _item.assign(first, last);
+                _itemStream.str(_item);
+                _itemStream.clear();
+                _itemStream >> value;
+                return value;
+            }
+
+        public:
+            // Reads next non-empty line without parsing it, see line() and parseLine()
+            bool readLine(std::istream &is) {
+                while (!is.eof()) {
+                    std::getline(is, _line);
+                    _bytes += _line.length() + (is.eof() ? 0 : 1);
+
+                    if (!_line.length()) {
+                        continue;
+                    }
+
+                    ++_rows;
+                    return true;
                 }
 
-                std::vector<std::string> line_items;
-                std::istringstream iss_line(line);
-                while (!iss_line.eof()) {
-                    std::string item;
-                    std::getline(iss_line, item, separator);
-                    line_items.push_back(item);
+                return false;
+            }
+
+            const std::string &line() const {
+                return _line;
+            }
+
+            // Parses individual items of the line to T into row()
+            void parseLine(const std::string &line, const char separator) {
+                _row.clear();
+                const char *first = line.data();
+                const char *end = first + line.size();
+
+                while (true) {
+                    const char *last = std::find(first, end, separator);
+                    _row.push_back(parseValue(first, last));
+
+                    if (last == end) {
+                        break;
+                    }
+                    first = last + 1;
                 }
+            }
 
-                // Parse individual strings to T
-                std::vector<T> current_row;
-                std::transform(line_items.begin(), line_items.end(), std::back_inserter(current_row),
-                               [](const std::string &s) {
-                                   T value;
-                                   std::istringstream iss(s);
-                                   iss >> value;
-                                   return value;
-                               });
-
-                if (m.getRows() == 0) {
-                    // Initialize matrix first row.
-                    m.resize(1, current_row.size());
-                } else {
-                    m.addRow();
+            // Reads next non-empty line into row(). Returns false at the end of the stream.
+            bool readRow(std::istream &is, const char separator) {
+                if (!readLine(is)) {
+                    return false;
                 }
 
-                if (current_row.size() != m.getColumns()) {
-                    throw std::logic_error("Columns amount inconsistent");
+                parseLine(_line, separator);
+                return true;
+            }
+
+            const std::vector<T> &row() const {
+                return _row;
+            }
+
+            // Bytes and non-empty rows read since construction or the last resetStatistics()
+            std::uint64_t bytes() const {
+                return _bytes;
+            }
+
+            std::uint64_t rows() const {
+                return _rows;
+            }
+
+            void resetStatistics() {
+                _bytes = _rows = 0;
+            }
+
+            // Takes the parsed row without copying
+            void swapRow(std::vector<T> &row) {
+                _row.swap(row);
+            }
+
+            // Optionally records positions of zero cells in row-major order, see matrix_processor::process()
+            std::istream &read(std::istream &is, matrix<T> &m, const char separator,
+                               std::vector<matrix_cell> *zeros = nullptr) {
+                m.resize(0, 0);
+                int row = 0, column = 0;
+
+                if (zeros) {
+                    zeros->clear();
                 }
 
-                // Copy valid values to a new row of the matrix.
-                column = 0;
+                while (readRow(is, separator)) {
+                    if (m.getRows() == 0) {
+                        // Initialize matrix first row.
+                        m.resize(1, _row.size());
+                    } else {
+                        m.addRow();
+                    }
 
-                for (auto value: current_row) {
-                    m[row][column++] = value;
+                    if (_row.size() != m.getColumns()) {
+                        throw std::logic_error("Columns amount inconsistent");
+                    }
+
+                    // Copy valid values to a new row of the matrix.
+                    column = 0;
+
+                    for (auto value: _row) {
+                        if (zeros && kernels::isZero(value)) {
+                            zeros->push_back({row, column});
+                        }
+
+                        m[row][column++] = value;
+                    }
+
+                    ++row;
                 }
 
-                ++row;
+                return is;
             }
+        };
 
-            return is;
+        template<class T>
+        std::istream &parseFromCsvStream(std::istream &is, matrix<T> &m, const char separator = DEFAULT_SEPARATOR,
+                                         std::vector<matrix_cell> *zeros = nullptr) {
+            csv_reader<T> reader;
+            return reader.read(is, m, separator, zeros);
         }
 
         // Convenience operators overload for matrix I/O
@@ -100,8 +318,10 @@ namespace solution {
             return parseFromCsvStream(is, m);
         }
 
+        // Optional reader and writer allow reusing their buffers between files
         template<class T>
-        matrix<T> load(const std::string &file_name, const char separator) {
+        matrix<T> load(const std::string &file_name, const char separator, std::vector<matrix_cell> *zeros = nullptr,
+                       csv_reader<T> *reader = nullptr) {
             std::ifstream file(file_name);
 
             if (!file.is_open()) {
@@ -109,14 +329,24 @@ namespace solution {
             }
 
             matrix<T> m;
-            parseFromCsvStream(file, m, separator);
+            if (reader) {
+                reader->read(file, m, separator, zeros);
+            } else {
+                parseFromCsvStream(file, m, separator, zeros);
+            }
             return std::move(m);
         }
 
         template<class T>
-        void save(const std::string &file_name, const matrix<T> &m, const char separator) {
+        void save(const std::string &file_name, const matrix<T> &m, const char separator,
+                  csv_writer<T> *writer = nullptr) {
             std::ofstream file(file_name);
-            writeToCsvStream(file, m, separator);
+
+            if (writer) {
+                writer->write(file, m, separator);
+            } else {
+                writeToCsvStream(file, m, separator);
+            }
         }
     };
 
@@ -0,0 +1,251 @@
+#ifndef TASK2_MATRIX_KERNELS_H
+#define TASK2_MATRIX_KERNELS_H
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+#include "matrix.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TASK2_KERNELS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace solution {
+
+    // Row kernels for the interior of a matrix, i.e. cells which have all four neighbours.
+    // No bounds checks are done here, callers peel the border cells.
+    namespace kernels {
+
+        // Cell to be interpolated. Floating point values count as zero when they truncate to zero.
+        template<class T>
+        inline bool isZero(T x) {
+            if constexpr (std::is_floating_point<T>::value) {
+                return x > -1 && x < 1;
+            } else {
+                return x == 0;
+            }
+        }
+
+        // Mean of values rounded towards zero, without overflow: floating point values are summed
+        // in double, narrow integers in long long, 64 bit integers as quotients and remainders.
+        template<class T, std::size_t N>
+        inline T mean(const T (&values)[N]) {
+            if constexpr (std::is_floating_point<T>::value) {
+                using accumulator = typename std::conditional<(sizeof(T) > sizeof(double)), T, double>::type;
+                accumulator sum = 0;
+                for (auto value: values) {
+                    sum += value;
+                }
+                return static_cast<T>(sum / static_cast<accumulator>(N));
+            } else if constexpr (sizeof(T) < sizeof(long long)) {
+                long long sum = 0;
+                for (auto value: values) {
+                    sum += value;
+                }
+                return static_cast<T>(sum / static_cast<long long>(N));
+            } else {
+                const T n = static_cast<T>(N);
+                T quotient = 0, remainder = 0;
+                for (auto value: values) {
+                    quotient += value / n;
+                    remainder += value % n;
+                }
+
+                quotient += remainder / n;
+                remainder %= n;
+
+                // quotient + remainder / n, rounded towards zero
+                if (quotient > 0 && remainder < 0) {
+                    --quotient;
+                } else if (quotient < 0 && remainder > 0) {
+                    ++quotient;
+                }
+                return quotient;
+            }
+        }
+
+        template<class T>
+        inline T average(T up, T down, T left, T right) {
+            const T values[] = {up, down, left, right};
+            return mean(values);
+        }
+
+        // Interpolates zero cells in [begin, end) of row `cur` in place, left to right.
+        // Requires begin >= 1 and end <= columns - 1. Returns number of interpolated cells.
+        template<class T>
+        inline int interpolateCells(const T *up, T *cur, const T *down, int begin, int end) {
+            int interpolated = 0;
+
+            for (int column = begin; column < end; ++column) {
+                if (isZero(cur[column])) {
+                    cur[column] = average(up[column], down[column], cur[column - 1], cur[column + 1]);
+                    ++interpolated;
+                }
+            }
+
+            return interpolated;
+        }
+
+        template<class T>
+        inline int interpolateRow(const T *up, T *cur, const T *down, int begin, int end) {
+            return interpolateCells(up, cur, down, begin, end);
+        }
+
+        // Appends zero cells of the row to `zeros`, left to right
+        template<class T>
+        inline void findZeros(const T *cur, int row, int begin, int end, std::vector<matrix_cell> &zeros) {
+            for (int column = begin; column < end; ++column) {
+                if (isZero(cur[column])) {
+                    zeros.push_back({row, column});
+                }
+            }
+        }
+
+        template<class T>
+        inline void findZerosInRow(const T *cur, int row, int columns, std::vector<matrix_cell> &zeros) {
+            findZeros(cur, row, 0, columns, zeros);
+        }
+
+#ifdef TASK2_KERNELS_SSE2
+        // A vector of cells is blended in one go unless two zero cells are adjacent: then the right
+        // one depends on the freshly interpolated left one, and the chunk is done cell by cell.
+        // Left neighbour of the first lane is already final, right neighbours are not visited yet,
+        // so the result is identical to the sequential scan.
+
+        inline int laneCount(int lanes) {
+            return (lanes & 1) + ((lanes >> 1) & 1) + ((lanes >> 2) & 1) + ((lanes >> 3) & 1);
+        }
+
+        inline int interpolateRow(const int *up, int *cur, const int *down, int begin, int end) {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128d quarter = _mm_set1_pd(0.25);
+            int column = begin;
+            int interpolated = 0;
+
+            for (; column + 4 <= end; column += 4) {
+                const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cur + column));
+                const __m128i zeroMask = _mm_cmpeq_epi32(value, zero);
+                const int lanes = _mm_movemask_ps(_mm_castsi128_ps(zeroMask));
+
+                if (lanes == 0) {
+                    continue;
+                }
+
+                if (lanes & (lanes << 1)) {
+                    interpolated += interpolateCells(up, cur, down, column, column + 4);
+                    continue;
+                }
+
+                // Sum in double is exact and cannot overflow, like mean() in long long
+                const __m128i up4 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(up + column));
+                const __m128i down4 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(down + column));
+                const __m128i left4 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cur + column - 1));
+                const __m128i right4 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cur + column + 1));
+
+                auto averageLanes = [quarter](__m128i up2, __m128i down2, __m128i left2, __m128i right2) {
+                    __m128d sum = _mm_add_pd(_mm_cvtepi32_pd(up2), _mm_cvtepi32_pd(down2));
+                    sum = _mm_add_pd(sum, _mm_cvtepi32_pd(left2));
+                    sum = _mm_add_pd(sum, _mm_cvtepi32_pd(right2));
+                    return _mm_cvttpd_epi32(_mm_mul_pd(sum, quarter));
+                };
+
+                auto high = [](__m128i x) {
+                    return _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 2, 3, 2));
+                };
+
+                const __m128i avg = _mm_unpacklo_epi64(averageLanes(up4, down4, left4, right4),
+                                                       averageLanes(high(up4), high(down4), high(left4), high(right4)));
+
+                // Zero lanes of value are zero, so OR is enough to blend
+                const __m128i result = _mm_or_si128(value, _mm_and_si128(zeroMask, avg));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(cur + column), result);
+                interpolated += laneCount(lanes);
+            }
+
+            return interpolated + interpolateCells(up, cur, down, column, end);
+        }
+
+        inline int interpolateRow(const double *up, double *cur, const double *down, int begin, int end) {
+            const __m128d one = _mm_set1_pd(1.0);
+            const __m128d minusOne = _mm_set1_pd(-1.0);
+            const __m128d quarter = _mm_set1_pd(0.25);
+            int column = begin;
+            int interpolated = 0;
+
+            for (; column + 2 <= end; column += 2) {
+                const __m128d value = _mm_loadu_pd(cur + column);
+
+                // Same as isZero()
+                const __m128d zeroMask = _mm_and_pd(_mm_cmpgt_pd(value, minusOne), _mm_cmplt_pd(value, one));
+                const int lanes = _mm_movemask_pd(zeroMask);
+
+                if (lanes == 0) {
+                    continue;
+                }
+
+                if (lanes == 3) {
+                    interpolated += interpolateCells(up, cur, down, column, column + 2);
+                    continue;
+                }
+
+                __m128d sum = _mm_add_pd(_mm_loadu_pd(up + column), _mm_loadu_pd(down + column));
+                sum = _mm_add_pd(sum, _mm_loadu_pd(cur + column - 1));
+                sum = _mm_add_pd(sum, _mm_loadu_pd(cur + column + 1));
+
+                // Multiplying by 0.25 is exact, same as dividing by 4.0
+                const __m128d avg = _mm_mul_pd(sum, quarter);
+                const __m128d result = _mm_or_pd(_mm_and_pd(zeroMask, avg), _mm_andnot_pd(zeroMask, value));
+                _mm_storeu_pd(cur + column, result);
+                ++interpolated;
+            }
+
+            return interpolated + interpolateCells(up, cur, down, column, end);
+        }
+
+        inline void findZerosInRow(const int *cur, int row, int columns, std::vector<matrix_cell> &zeros) {
+            const __m128i zero = _mm_setzero_si128();
+            int column = 0;
+
+            for (; column + 4 <= columns; column += 4) {
+                const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cur + column));
+                const int lanes = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(value, zero)));
+
+                for (int lane = 0; lane < 4; ++lane) {
+                    if (lanes & (1 << lane)) {
+                        zeros.push_back({row, column + lane});
+                    }
+                }
+            }
+
+            findZeros(cur, row, column, columns, zeros);
+        }
+
+        inline void findZerosInRow(const double *cur, int row, int columns, std::vector<matrix_cell> &zeros) {
+            const __m128d one = _mm_set1_pd(1.0);
+            const __m128d minusOne = _mm_set1_pd(-1.0);
+            int column = 0;
+
+            for (; column + 2 <= columns; column += 2) {
+                const __m128d value = _mm_loadu_pd(cur + column);
+                const int lanes = _mm_movemask_pd(
+                        _mm_and_pd(_mm_cmpgt_pd(value, minusOne), _mm_cmplt_pd(value, one)));
+
+                if (lanes & 1) {
+                    zeros.push_back({row, column});
+                }
+
+                if (lanes & 2) {
+                    zeros.push_back({row, column + 1});
+                }
+            }
+
+            findZeros(cur, row, column, columns, zeros);
+        }
+#endif
+    }
+
+} // solution
+
+#endif //TASK2_MATRIX_KERNELS_H
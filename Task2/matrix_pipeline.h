@@ -0,0 +1,292 @@
+#ifndef TASK2_MATRIX_PIPELINE_H
+#define TASK2_MATRIX_PIPELINE_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "matrix_io.h"
+#include "processing_stats.h"
+
+namespace solution {
+
+    // Blocking queue with limited capacity connecting pipeline stages
+    template<class Item>
+    class bounded_queue {
+    private:
+        std::deque<Item> _items;
+        std::size_t _capacity;
+        bool _closed = false;
+        std::mutex _mutex;
+        std::condition_variable _changed;
+
+    public:
+        explicit bounded_queue(std::size_t capacity) : _capacity(std::max<std::size_t>(capacity, 1)) {
+        }
+
+        // Waits for free space. Returns false if the queue was closed, the item is dropped then.
+        bool push(Item item) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _changed.wait(lock, [this] { return _closed || _items.size() < _capacity; });
+
+            if (_closed) {
+                return false;
+            }
+
+            _items.push_back(std::move(item));
+            _changed.notify_all();
+            return true;
+        }
+
+        // Waits for an item. Returns false when the queue is closed and empty.
+        bool pop(Item &item) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _changed.wait(lock, [this] { return _closed || !_items.empty(); });
+
+            if (_items.empty()) {
+                return false;
+            }
+
+            item = std::move(_items.front());
+            _items.pop_front();
+            _changed.notify_all();
+            return true;
+        }
+
+        // No more items will be pushed. Items already queued can still be popped.
+        void close() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _closed = true;
+            _changed.notify_all();
+        }
+    };
+
+    // Streams a CSV matrix through reader, processing and writer stages running at the same time,
+    // so that I/O overlaps with computation and only a few blocks of rows are in memory.
+    template<class T>
+    class matrix_pipeline {
+    private:
+        using row_type = std::vector<T>;
+        using row_block = std::vector<row_type>;
+
+        std::size_t _blockRows;
+        std::size_t _queueBlocks;
+
+        // Keeps the first exception of any stage
+        struct failure {
+            std::exception_ptr error;
+            std::mutex mutex;
+
+            void set(std::exception_ptr e) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) {
+                    error = e;
+                }
+            }
+
+            bool isSet() {
+                std::lock_guard<std::mutex> lock(mutex);
+                return static_cast<bool>(error);
+            }
+        };
+
+        void readStage(std::istream &is, const char separator, matrix_io::csv_reader<T> &reader,
+                       bounded_queue<row_block> &input, failure &failed, stats::processing_stats *statistics) {
+            const stats::phase_timer timer;
+            const auto bytes = reader.bytes();
+            const auto rows = reader.rows();
+
+            try {
+                row_block block;
+                std::size_t columns = 0;
+
+                while (reader.readRow(is, separator)) {
+                    if (columns == 0) {
+                        columns = reader.row().size();
+                    } else if (reader.row().size() != columns) {
+                        throw std::logic_error("Columns amount inconsistent");
+                    }
+
+                    block.emplace_back();
+                    reader.swapRow(block.back());
+
+                    if (block.size() == _blockRows) {
+                        if (!input.push(std::move(block))) {
+                            break;
+                        }
+                        block = row_block();
+                    }
+                }
+
+                if (!block.empty()) {
+                    input.push(std::move(block));
+                }
+            }
+            catch (...) {
+                failed.set(std::current_exception());
+            }
+
+            input.close();
+
+            if (statistics) {
+                statistics->addPhase(timer.stop("read", reader.bytes() - bytes, reader.rows() - rows));
+            }
+        }
+
+        void writeStage(std::ostream &os, const char separator, matrix_io::csv_writer<T> &writer,
+                        bounded_queue<row_block> &output, failure &failed, stats::processing_stats *statistics) {
+            const stats::phase_timer timer;
+            const auto bytes = writer.bytes();
+            const auto rows = writer.rows();
+
+            try {
+                row_block block;
+
+                while (output.pop(block)) {
+                    for (const auto &row: block) {
+                        writer.writeRow(os, row.data(), static_cast<int>(row.size()), separator);
+                    }
+                }
+
+                writer.flush(os);
+                os.flush();
+            }
+            catch (...) {
+                failed.set(std::current_exception());
+                output.close();
+            }
+
+            if (statistics) {
+                statistics->addPhase(timer.stop("write", writer.bytes() - bytes, writer.rows() - rows));
+            }
+        }
+
+        // Row i is processed as soon as row i + 1 is read, and is written out once row i + 1 is
+        // processed, because it serves as the upper neighbour until then.
+        template<class Processor>
+        void processStage(Processor &p, bounded_queue<row_block> &input, bounded_queue<row_block> &output,
+                          failure &failed, stats::processing_stats *statistics) {
+            const stats::phase_timer timer;
+            const auto interpolated = p.interpolatedCells();
+            std::uint64_t rows = 0, columns = 0;
+
+            row_type previous, current;
+            bool hasPrevious = false, hasCurrent = false;
+            row_block in, out;
+
+            auto emit = [this, &out, &output](row_type &row) {
+                out.push_back(std::move(row));
+
+                if (out.size() == _blockRows) {
+                    output.push(std::move(out));
+                    out = row_block();
+                }
+            };
+
+            while (input.pop(in)) {
+                for (auto &next: in) {
+                    if (hasCurrent) {
+                        p.processRow(hasPrevious ? previous.data() : nullptr, current.data(), next.data(),
+                                     static_cast<int>(current.size()));
+
+                        if (hasPrevious) {
+                            emit(previous);
+                        }
+
+                        previous = std::move(current);
+                        hasPrevious = true;
+                    }
+
+                    current = std::move(next);
+                    hasCurrent = true;
+                    columns = current.size();
+                    ++rows;
+                }
+            }
+
+            // The reader closes the input only after recording its failure, so the last row received
+            // is not the bottom border then and must not be written
+            if (hasCurrent && !failed.isSet()) {
+                p.processRow(hasPrevious ? previous.data() : nullptr, current.data(), static_cast<const T *>(nullptr),
+                             static_cast<int>(current.size()));
+
+                if (hasPrevious) {
+                    emit(previous);
+                }
+                emit(current);
+            }
+
+            if (!out.empty()) {
+                output.push(std::move(out));
+            }
+
+            if (statistics) {
+                statistics->rows = rows;
+                statistics->columns = columns;
+                statistics->cellsInterpolated = p.interpolatedCells() - interpolated;
+                statistics->addPhase(timer.stop("process", rows * columns * sizeof(T), rows));
+            }
+        }
+
+    public:
+        static constexpr std::size_t DEFAULT_BLOCK_ROWS = 256;
+        static constexpr std::size_t DEFAULT_QUEUE_BLOCKS = 4;
+        // Threads busy during run(), the calling one included
+        static constexpr unsigned THREADS = 3;
+
+        explicit matrix_pipeline(std::size_t blockRows = DEFAULT_BLOCK_ROWS,
+                                 std::size_t queueBlocks = DEFAULT_QUEUE_BLOCKS)
+                : _blockRows(std::max<std::size_t>(blockRows, 1)), _queueBlocks(queueBlocks) {
+        }
+
+        // Same result as parseFromCsvStream(), p.process() and writeToCsvStream() in sequence.
+        // Reader and writer run on their own threads, processing runs on the calling one.
+        // Each stage adds its phase to `statistics` if given; phases overlap in time.
+        template<class Processor>
+        void run(std::istream &is, std::ostream &os, const char separator, Processor &p,
+                 matrix_io::csv_reader<T> &reader, matrix_io::csv_writer<T> &writer,
+                 stats::processing_stats *statistics = nullptr) {
+            bounded_queue<row_block> input(_queueBlocks), output(_queueBlocks);
+            failure failed;
+
+            std::thread readThread([&] { readStage(is, separator, reader, input, failed, statistics); });
+            std::thread writeThread([&] { writeStage(os, separator, writer, output, failed, statistics); });
+
+            try {
+                processStage(p, input, output, failed, statistics);
+            }
+            catch (...) {
+                // Closed input stops the reader even if it waits for room, so both threads can be joined
+                failed.set(std::current_exception());
+                input.close();
+            }
+            output.close();
+
+            readThread.join();
+            writeThread.join();
+
+            if (failed.error) {
+                std::rethrow_exception(failed.error);
+            }
+        }
+
+        template<class Processor>
+        void run(std::istream &is, std::ostream &os, const char separator, Processor &p,
+                 stats::processing_stats *statistics = nullptr) {
+            matrix_io::csv_reader<T> reader;
+            matrix_io::csv_writer<T> writer;
+            run(is, os, separator, p, reader, writer, statistics);
+        }
+    };
+
+} // solution
+
+#endif //TASK2_MATRIX_PIPELINE_H
@@ -5,53 +5,172 @@
 #ifndef TASK2_MATRIX_PROCESSOR_H
 #define TASK2_MATRIX_PROCESSOR_H
 
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
 #include "matrix.h"
+#include "matrix_kernels.h"
+#include "matrix_stencils.h"
 
 namespace solution {
 
-    class matrix_processor {
+    // Replaces cells selected by Predicate with value computed by Stencil, see matrix_stencils.h.
+    // Policies are chosen at compile time, so they are inlined into the row loop.
+    template<class Stencil = stencils::average4, class Predicate = stencils::is_zero>
+    class basic_matrix_processor {
     private:
-        // Interpolation value for out-of-boundary cells
-        const int INTERPOLATE_DEFAULT_VALUE = 0;
+        Stencil _stencil;
+        Predicate _predicate;
+
+        // Statistics
+        std::uint64_t _interpolated = 0;
 
-        bool isZero(int x) {
-            return x == 0;
+        // Default policies have vectorized kernels for interior cells
+        static constexpr bool HAS_KERNEL = std::is_same<Stencil, stencils::average4>::value &&
+                                           std::is_same<Predicate, stencils::is_zero>::value;
+
+        template<bool Checked, class T>
+        void visitor(const T *const *rows, T *cur, int column, int columns) {
+            if (_predicate(cur[column])) {
+                cur[column] = _stencil(stencils::neighbourhood<T, Checked>{rows, column, columns});
+                ++_interpolated;
+            }
         }
 
         template<class T>
-        T get(const matrix<T> &m, int row, int column) {
-            if (row < 0 || row >= m.getRows() || column < 0 || column >= m.getColumns()) {
-                return static_cast<T>(INTERPOLATE_DEFAULT_VALUE);
-            }
+        void visitor(matrix<T> &m, int row, int column) {
+            const T *rows[] = {row > 0 ? m[row - 1].data() : nullptr,
+                               m[row].data(),
+                               row + 1 < m.getRows() ? m[row + 1].data() : nullptr};
+            visitor<true>(rows, m[row].data(), column, m.getColumns());
+        }
 
-            return m[row][column];
+    public:
+        explicit basic_matrix_processor(Stencil stencil = Stencil(), Predicate predicate = Predicate())
+                : _stencil(stencil), _predicate(predicate) {
         }
 
-        template<class T>
-        T interpolate(const matrix<T> &m, int row, int column) {
-            T sum = get(m, row - 1, column) +
-                    get(m, row + 1, column) +
-                    get(m, row, column - 1) +
-                    get(m, row, column + 1);
-            return static_cast<T>(sum / 4.0);
+        // Number of cells replaced since construction or the last resetStatistics()
+        std::uint64_t interpolatedCells() const {
+            return _interpolated;
+        }
+
+        void resetStatistics() {
+            _interpolated = 0;
         }
 
+        // Processes one row in place. `up` and `down` are null for the first and the last row.
+        // Rows above must be processed already, rows below must not be processed yet.
         template<class T>
-        void visitor(matrix<T> &m, int row, int column) {
-            if (isZero(m[row][column])) {
-                m[row][column] = interpolate(m, row, column);
+        void processRow(const T *up, T *cur, const T *down, int columns) {
+            const T *rows[] = {up, cur, down};
+
+            if (!up || !down || columns < 3) {
+                for (int column = 0; column < columns; ++column) {
+                    visitor<true>(rows, cur, column, columns);
+                }
+                return;
+            }
+
+            // Only the first and the last column need out-of-boundary handling
+            visitor<true>(rows, cur, 0, columns);
+
+            if constexpr (HAS_KERNEL) {
+                _interpolated += kernels::interpolateRow(up, cur, down, 1, columns - 1);
+            } else {
+                for (int column = 1; column < columns - 1; ++column) {
+                    visitor<false>(rows, cur, column, columns);
+                }
             }
+
+            visitor<true>(rows, cur, columns - 1, columns);
         }
 
-    public:
         // Sample processing function. Averages zero cell among sibling cells.
+        // Cells are visited row by row, so interpolated values take part in later averages.
         template<class T>
         void process(matrix<T> &m) {
+            const int rows = m.getRows();
+
+            for (int row = 0; row < rows; ++row) {
+                processRow(row > 0 ? m[row - 1].data() : nullptr,
+                           m[row].data(),
+                           row + 1 < rows ? m[row + 1].data() : nullptr,
+                           m.getColumns());
+            }
+        }
+
+        // Same as process(m), but visits only the given cells. Cells not matching the predicate are
+        // never changed, so passing all matching cells of `m` in row-major order gives identical result.
+        template<class T>
+        void process(matrix<T> &m, const std::vector<matrix_cell> &zeros) {
+            for (const auto &cell: zeros) {
+                visitor(m, cell.row, cell.column);
+            }
+        }
+
+        // Cells matching the predicate in row-major order, to be used with process(m, zeros)
+        template<class T>
+        std::vector<matrix_cell> findZeros(const matrix<T> &m) {
+            std::vector<matrix_cell> zeros;
+
             for (int row = 0; row < m.getRows(); ++row) {
-                for (int column = 0; column < m.getColumns(); ++column) {
-                    visitor(m, row, column);
+                const T *cur = m[row].data();
+
+                if constexpr (std::is_same<Predicate, stencils::is_zero>::value) {
+                    kernels::findZerosInRow(cur, row, m.getColumns(), zeros);
+                } else {
+                    for (int column = 0; column < m.getColumns(); ++column) {
+                        if (_predicate(cur[column])) {
+                            zeros.push_back({row, column});
+                        }
+                    }
                 }
             }
+
+            return zeros;
+        }
+    };
+
+    using matrix_processor = basic_matrix_processor<>;
+
+    // Runs several processors in a single sweep over the matrix, with the same result as calling
+    // process() of each one in turn. Pass k works one row behind pass k - 1, so it sees rows above
+    // already done by itself and rows below done by the previous pass only. Only a few rows are
+    // touched at each step, so they stay in cache instead of going through memory once per pass.
+    template<class... Processors>
+    class fused_processor {
+    private:
+        std::tuple<Processors...> _passes;
+
+        template<class Processor, class T>
+        static void processRow(Processor &pass, matrix<T> &m, int row) {
+            if (row < 0 || row >= m.getRows()) {
+                return;
+            }
+
+            pass.processRow(row > 0 ? m[row - 1].data() : nullptr,
+                            m[row].data(),
+                            row + 1 < m.getRows() ? m[row + 1].data() : nullptr,
+                            m.getColumns());
+        }
+
+    public:
+        explicit fused_processor(Processors... passes) : _passes(passes...) {
+        }
+
+        template<class T>
+        void process(matrix<T> &m) {
+            const int steps = m.getRows() + static_cast<int>(sizeof...(Processors)) - 1;
+
+            for (int step = 0; step < steps; ++step) {
+                std::apply([&m, step](Processors &... passes) {
+                    int lag = 0;
+                    (processRow(passes, m, step - lag++), ...);
+                }, _passes);
+            }
         }
     };
 
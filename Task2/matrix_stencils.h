@@ -0,0 +1,127 @@
+#ifndef TASK2_MATRIX_STENCILS_H
+#define TASK2_MATRIX_STENCILS_H
+
+#include "matrix_kernels.h"
+
+namespace solution {
+
+    // Policies for basic_matrix_processor. A predicate selects cells to be replaced,
+    // a stencil computes the new value from the 3x3 neighbourhood of the cell.
+    namespace stencils {
+        // Interpolation value for out-of-boundary cells
+        const int INTERPOLATE_DEFAULT_VALUE = 0;
+
+        // 3x3 neighbourhood of a cell. Rows above and below are null outside the matrix.
+        // Unchecked version is used for interior cells, where all neighbours exist.
+        template<class T, bool Checked>
+        struct neighbourhood {
+            using value_type = T;
+
+            const T *const *rows;
+            int column;
+            int columns;
+
+            T operator()(int dRow, int dColumn) const {
+                const T *row = rows[dRow + 1];
+                const int neighbour = column + dColumn;
+
+                if (Checked && (!row || neighbour < 0 || neighbour >= columns)) {
+                    return static_cast<T>(INTERPOLATE_DEFAULT_VALUE);
+                }
+
+                return row[neighbour];
+            }
+
+            T value() const {
+                return rows[1][column];
+            }
+        };
+
+        // Predicates
+
+        struct is_zero {
+            template<class T>
+            bool operator()(T x) const {
+                return kernels::isZero(x);
+            }
+        };
+
+        struct always {
+            template<class T>
+            bool operator()(T) const {
+                return true;
+            }
+        };
+
+        struct below {
+            double limit = 0;
+
+            template<class T>
+            bool operator()(T x) const {
+                return x < limit;
+            }
+        };
+
+        // Stencils
+
+        // Average of four adjacent cells
+        struct average4 {
+            template<class Neighbourhood>
+            auto operator()(const Neighbourhood &n) const {
+                using T = typename Neighbourhood::value_type;
+                const T values[] = {n(-1, 0), n(1, 0), n(0, -1), n(0, 1)};
+                return kernels::mean(values);
+            }
+        };
+
+        // Average of all eight surrounding cells
+        struct average8 {
+            template<class Neighbourhood>
+            auto operator()(const Neighbourhood &n) const {
+                using T = typename Neighbourhood::value_type;
+                const T values[] = {n(-1, -1), n(-1, 0), n(-1, 1),
+                                    n(0, -1), n(0, 1),
+                                    n(1, -1), n(1, 0), n(1, 1)};
+                return kernels::mean(values);
+            }
+        };
+
+        // Weighted average over 3x3 window, weights are normalized by their sum
+        struct weighted3x3 {
+            double weights[3][3] = {{1, 2, 1},
+                                    {2, 0, 2},
+                                    {1, 2, 1}};
+
+            template<class Neighbourhood>
+            auto operator()(const Neighbourhood &n) const {
+                using T = typename Neighbourhood::value_type;
+                double sum = 0, total = 0;
+
+                for (int dRow = -1; dRow <= 1; ++dRow) {
+                    for (int dColumn = -1; dColumn <= 1; ++dColumn) {
+                        const double weight = weights[dRow + 1][dColumn + 1];
+                        sum += weight * n(dRow, dColumn);
+                        total += weight;
+                    }
+                }
+
+                return total != 0 ? static_cast<T>(sum / total) : n.value();
+            }
+        };
+
+        // Values below `limit` become `replacement`, others are kept
+        struct threshold {
+            double limit = 0;
+            double replacement = 0;
+
+            template<class Neighbourhood>
+            auto operator()(const Neighbourhood &n) const {
+                using T = typename Neighbourhood::value_type;
+                return n.value() < limit ? static_cast<T>(replacement) : n.value();
+            }
+        };
+    }
+
+} // solution
+
+#endif //TASK2_MATRIX_STENCILS_H
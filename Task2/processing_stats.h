@@ -0,0 +1,208 @@
+#ifndef TASK2_PROCESSING_STATS_H
+#define TASK2_PROCESSING_STATS_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace solution {
+
+    // Timing, throughput and memory statistics of processing phases
+    namespace stats {
+
+        // Allocations made by the calling thread. Counted only if the program replaces
+        // global operator new to increment it, as Task2 does.
+        inline std::uint64_t &threadAllocations() {
+            thread_local std::uint64_t allocations = 0;
+            return allocations;
+        }
+
+        // CPU time of the calling thread
+        inline double threadCpuSeconds() {
+#ifdef _WIN32
+            FILETIME creation, exit, kernel, user;
+            GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user);
+            auto ticks = [](const FILETIME &t) {
+                return (static_cast<std::uint64_t>(t.dwHighDateTime) << 32) | t.dwLowDateTime;
+            };
+            return (ticks(kernel) + ticks(user)) * 1e-7;
+#else
+            timespec time;
+            clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+            return time.tv_sec + time.tv_nsec * 1e-9;
+#endif
+        }
+
+        inline std::uint64_t peakResidentBytes() {
+#ifdef _WIN32
+            PROCESS_MEMORY_COUNTERS counters;
+            if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+                return 0;
+            }
+            return counters.PeakWorkingSetSize;
+#else
+            rusage usage;
+            getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+            return static_cast<std::uint64_t>(usage.ru_maxrss);
+#else
+            return static_cast<std::uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+        }
+
+        struct phase_stats {
+            std::string name;
+            double wallSeconds = 0;
+            double cpuSeconds = 0;
+            std::uint64_t bytes = 0;
+            std::uint64_t rows = 0;
+            std::uint64_t allocations = 0;
+            // Thread the phase ran on
+            std::thread::id thread;
+        };
+
+        // Measures wall time, CPU time and allocations of the calling thread from construction to stop()
+        class phase_timer {
+        private:
+            std::chrono::steady_clock::time_point _wallStart;
+            double _cpuStart;
+            std::uint64_t _allocationsStart;
+
+        public:
+            phase_timer() : _wallStart(std::chrono::steady_clock::now()),
+                            _cpuStart(threadCpuSeconds()),
+                            _allocationsStart(threadAllocations()) {
+            }
+
+            phase_stats stop(const std::string &name, std::uint64_t bytes = 0, std::uint64_t rows = 0) const {
+                phase_stats phase;
+                phase.name = name;
+                phase.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - _wallStart).count();
+                phase.cpuSeconds = threadCpuSeconds() - _cpuStart;
+                phase.bytes = bytes;
+                phase.rows = rows;
+                phase.allocations = threadAllocations() - _allocationsStart;
+                phase.thread = std::this_thread::get_id();
+                return phase;
+            }
+        };
+
+        // Statistics of one processed matrix. Phases may be added from several threads.
+        class processing_stats {
+        private:
+            std::vector<phase_stats> _phases;
+            std::vector<std::pair<std::string, std::string>> _labels;
+            std::mutex _mutex;
+
+            static void writeString(std::ostream &os, const std::string &s) {
+                os << '"';
+                for (char c: s) {
+                    if (c == '"' || c == '\\') {
+                        os << '\\' << c;
+                    } else if (static_cast<unsigned char>(c) < 0x20) {
+                        char escaped[8];
+                        std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                        os << escaped;
+                    } else {
+                        os << c;
+                    }
+                }
+                os << '"';
+            }
+
+            static double perSecond(std::uint64_t amount, double seconds) {
+                return seconds > 0 ? amount / seconds : 0;
+            }
+
+        public:
+            std::uint64_t rows = 0;
+            std::uint64_t columns = 0;
+            std::uint64_t cellsInterpolated = 0;
+
+            void addPhase(const phase_stats &phase) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _phases.push_back(phase);
+            }
+
+            // Adds the phase covering the whole file, measured by `timer` on the calling thread. CPU time and
+            // allocations of phases run on other threads are added, as the timer sees only its own thread.
+            void addTotal(const phase_timer &timer, std::uint64_t bytes) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                auto total = timer.stop("total", bytes, rows);
+
+                for (const auto &phase: _phases) {
+                    if (phase.thread != total.thread) {
+                        total.cpuSeconds += phase.cpuSeconds;
+                        total.allocations += phase.allocations;
+                    }
+                }
+
+                _phases.push_back(total);
+            }
+
+            // Extra string fields of the JSON object, like file names
+            void addLabel(const std::string &key, const std::string &value) {
+                _labels.emplace_back(key, value);
+            }
+
+            const std::vector<phase_stats> &phases() const {
+                return _phases;
+            }
+
+            // Writes statistics as a single line JSON object
+            std::ostream &writeJson(std::ostream &os) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                os << '{';
+
+                for (const auto &label: _labels) {
+                    writeString(os, label.first);
+                    os << ':';
+                    writeString(os, label.second);
+                    os << ',';
+                }
+
+                os << "\"rows\":" << rows << ",\"columns\":" << columns
+                   << ",\"cells_interpolated\":" << cellsInterpolated
+                   << ",\"peak_resident_bytes\":" << peakResidentBytes()
+                   << ",\"phases\":[";
+
+                for (std::size_t i = 0; i < _phases.size(); ++i) {
+                    const auto &phase = _phases[i];
+                    os << (i ? "," : "") << "{\"name\":";
+                    writeString(os, phase.name);
+                    os << ",\"wall_seconds\":" << phase.wallSeconds
+                       << ",\"cpu_seconds\":" << phase.cpuSeconds
+                       << ",\"bytes\":" << phase.bytes
+                       << ",\"rows\":" << phase.rows
+                       << ",\"bytes_per_second\":" << perSecond(phase.bytes, phase.wallSeconds)
+                       << ",\"rows_per_second\":" << perSecond(phase.rows, phase.wallSeconds)
+                       << ",\"allocations\":" << phase.allocations << '}';
+                }
+
+                os << "]}";
+                return os;
+            }
+        };
+    }
+
+} // solution
+
+#endif //TASK2_PROCESSING_STATS_H